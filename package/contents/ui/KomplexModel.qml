@@ -247,7 +247,7 @@ Rectangle
             {
                 if (component.status === Component.Ready) 
                 { 
-                    channel.iChannel0 = component.createObject(mainItem, {  })
+                    channel.iChannel0 = component.createObject(mainItem, { windowModel: windowModel })
                     parseChannel(channel.iChannel0, json.channel0)
                 }
             }
@@ -268,7 +268,7 @@ Rectangle
             {
                 if (component.status === Component.Ready) 
                 { 
-                    channel.iChannel1 = component.createObject(mainItem, { })
+                    channel.iChannel1 = component.createObject(mainItem, { windowModel: windowModel })
                     parseChannel(channel.iChannel1, json.channel1)
                 }
             }
@@ -289,7 +289,7 @@ Rectangle
             {
                 if (component.status === Component.Ready) 
                 {
-                    channel.iChannel2 = component.createObject(mainItem, { })
+                    channel.iChannel2 = component.createObject(mainItem, { windowModel: windowModel })
                     parseChannel(channel.iChannel2, json.channel2)
                 }
             }
@@ -310,7 +310,7 @@ Rectangle
             {
                 if (component.status === Component.Ready) 
                 { 
-                    channel.iChannel3 = component.createObject(mainItem, { })
+                    channel.iChannel3 = component.createObject(mainItem, { windowModel: windowModel })
                     parseChannel(channel.iChannel3, json.channel3)
                 }
             }
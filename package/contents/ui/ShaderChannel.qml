@@ -80,6 +80,12 @@ Item
     property var format: ShaderEffectSource.RGBA8
     property var windowModel
 
+    // audio features for the iAudioBands and iAudioBeat uniforms, taken from this channel's own
+    // audio texture or from the first input channel that has some
+    readonly property var audioFeatures: channel.type === ShaderChannel.AudioChannel ? loader.item : [iChannel0, iChannel1, iChannel2, iChannel3].map(input => input ? input.audioFeatures : null).find(features => features) ?? null
+    property vector4d iAudioBands: audioFeatures ? audioFeatures.bands : Qt.vector4d(0, 0, 0, 0) // sub bass, bass, mid, treble
+    property vector4d iAudioBeat: audioFeatures ? audioFeatures.beat : Qt.vector4d(0, 0, 0, 0) // flux, beat phase, bpm, loudness
+
     property var iChannelResolution: [Qt.vector3d(channel.iResolution.x * iResolutionScale, channel.iResolution.y * iResolutionScale, 1), Qt.vector3d(channel.iResolution.x * iResolutionScale, channel.iResolution.y * iResolutionScale, 1), Qt.vector3d(channel.iResolution.x * iResolutionScale, channel.iResolution.y * iResolutionScale, 1)]
 
     onIResolutionChanged: () =>
@@ -304,6 +310,8 @@ Item
                 property var iFrameRate: channel.iFrameRate
                 property var iMouse: data.iMouse
                 property var iDate: channel.iDate
+                property var iAudioBands: channel.iAudioBands
+                property var iAudioBeat: channel.iAudioBeat
 
                 property var iChannelResolution: channel.iResolution
 
@@ -575,54 +583,20 @@ Item
         }
     }
 
-    // Connect the audio channel to the cpp backend
+    // Connect the audio channel to the cpp backend. The texture item starts the capture
+    // itself and is only redrawn when the analyzer publishes a new frame. The capture
+    // stream is suspended while the window model has the wallpaper paused
     Component
     {
         id: channelAudio
 
-        Rectangle
+        Komplex.AudioTexture
         {
             width: 512
             height: 2
-            color: "black"
             anchors.top: parent.top
-            Image
-            {
-                anchors.fill: parent
-                id: textureImage
-                source: "image://audiotexture/frame"
-                fillMode: Image.Pad
-                cache: false
-            }
-
-            Timer
-            {
-                property int frame: 0
-                interval: 16
-                repeat: true
-                triggeredOnStart: false
-                running: false
-                id: audioFrameTimer
-
-                onTriggered: () =>
-                {
-                    //lets hope there's no auto caching and we can prevent overflow like this
-                    frame = frame === 0 ? 1 : 0
-                    textureImage.source = "image://audiotexture/frame" + frame
-                }
-            }
-
-            Component.onCompleted: () =>
-            {
-                Komplex.AudioModel.startCapture()
-                audioFrameTimer.start()
-            }
-
-            Component.onDestruction: () =>
-            {
-                audioFrameTimer.stop()
-                Komplex.AudioModel.stopCapture()
-            }
+            active: channel.windowModel ? channel.windowModel.runShader : true
+            sharedAnalysis: typeof wallpaper !== "undefined" && wallpaper.configuration.sharedAudioAnalysis
         }
     }
 
@@ -733,6 +707,8 @@ Item
                             property var iFrameRate: channel.iFrameRate
                             property var iMouse: data.iMouse
                             property var iDate: channel.iDate
+                            property var iAudioBands: channel.iAudioBands
+                            property var iAudioBeat: channel.iAudioBeat
 
                             property var iChannelResolution: channel.iResolution
 
@@ -89,6 +89,7 @@ Kirigami.FormLayout
     property bool cfg_infoiChannelSettings_dismissed
     property alias cfg_checkActiveScreen: activeScreenOnlyCheckbox.checked
     property alias cfg_excludeWindows: excludeWindows.windows
+    property alias cfg_sharedAudioAnalysis: sharedAudioAnalysisCheckbox.checked
     property alias cfg_running: runningCombo.checked
 
     property alias cfg_shader_package: selectedShaderPack.shader
@@ -241,19 +242,40 @@ Kirigami.FormLayout
             }
 
             textRole: "modelData"
-            currentIndex: root.cfg_shader_package_index
             displayText: currentIndex === -1 ? "Custom File" : currentText.replace("_", " ").charAt(0).toUpperCase() + currentText.replace("_", " ").slice(1)
 
-            onCurrentTextChanged: 
+            // the list changes when a scan finds packs added or removed, so
+            // the configured pack is looked up by its file rather than kept
+            // by index
+            function selectShaderPack()
             {
-                root.cfg_shader_package_index = currentIndex;
+                var packs = shaderPackModel.availableShaderPacks
 
-                if (root.cfg_shader_package_index === -1)
-                    return;
+                for (var i = 0; i < packs.length; ++i)
+                {
+                    if ("file://" + shaderPackModel.path(packs[i]) === root.cfg_shader_package)
+                    {
+                        currentIndex = i
+                        return
+                    }
+                }
 
-                var source = currentText
-                shaderPackModel.loadMetadata(source)
-                root.cfg_shader_package = "file://" + shaderPackModel.path(source)
+                currentIndex = -1
+            }
+
+            onModelChanged: selectShaderPack()
+            Component.onCompleted: selectShaderPack()
+
+            onCurrentTextChanged: 
+            {
+                if (currentIndex !== -1)
+                    shaderPackModel.loadMetadata(currentText)
+            }
+
+            // only a choice of the user changes the configured pack
+            onActivated: (index) =>
+            {
+                root.cfg_shader_package = "file://" + shaderPackModel.path(textAt(index))
             }
         }
 
@@ -815,6 +837,17 @@ Kirigami.FormLayout
         ToolTip.text: qsTr("A comma-separated list of fully-qualified App-IDs to exclude their windows from triggering pause mode.")
     }
 
+    CheckBox 
+    {
+        visible: navBar.currentIndex === 1
+        id: sharedAudioAnalysisCheckbox
+
+        Kirigami.FormData.label: i18nd("com.github.digitalartifex.komplex", "Audio:")
+        text: i18n("Share audio analysis between screens")
+        ToolTip.visible: hovered
+        ToolTip.text: qsTr("Capture and analyse audio once for every wallpaper instance instead of once per process. Applies after a restart.")
+    }
+
     CheckBox 
     {
         visible: navBar.currentIndex === 1
@@ -0,0 +1,335 @@
+#include "AudioAnalyzer.h"
+#include "AudioKernels.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+
+namespace
+{
+// the non linear mappings cover the audible range, or up to nyquist for low rates
+constexpr double MinimumFrequency = 20.0;
+constexpr double MaximumFrequency = 20000.0;
+
+// converts hertz onto the scale the band edges are evenly spaced on
+double toScale(AudioAnalyzer::Mapping mapping, double hz)
+{
+    switch(mapping)
+    {
+    case AudioAnalyzer::Logarithmic:
+        return std::log2(hz);
+    case AudioAnalyzer::Mel:
+        return 2595.0 * std::log10(1.0 + hz / 700.0);
+    case AudioAnalyzer::Bark: // Traunmüller
+        return 26.81 * hz / (1960.0 + hz) - 0.53;
+    case AudioAnalyzer::Linear:
+        break;
+    }
+
+    return hz;
+}
+
+double fromScale(AudioAnalyzer::Mapping mapping, double value)
+{
+    switch(mapping)
+    {
+    case AudioAnalyzer::Logarithmic:
+        return std::exp2(value);
+    case AudioAnalyzer::Mel:
+        return 700.0 * (std::pow(10.0, value / 2595.0) - 1.0);
+    case AudioAnalyzer::Bark:
+        return 1960.0 * (value + 0.53) / (26.28 - value);
+    case AudioAnalyzer::Linear:
+        break;
+    }
+
+    return value;
+}
+}
+
+AudioAnalyzer::AudioAnalyzer(int size, quint32 rate, quint32 channels, int textureWidth, Mapping mapping)
+    : m_size(size),
+    m_rate(rate),
+    m_channels(std::max<quint32>(channels, 1)),
+    m_textureWidth(textureWidth),
+    m_mapping(mapping),
+    m_frame(size * m_channels, 0.0f),
+    m_planar(m_channels > 1 ? size * m_channels : 0, 0.0f),
+    m_magnitude(bins(), 0.0f),
+    m_smoothed(bins() * m_channels, 0.0f),
+    m_bands(textureWidth * m_channels, 0.0f),
+    m_peaks(textureWidth * m_channels, 0.0f),
+    m_texture(textureWidth * m_channels * 2, 0),
+    m_features(size, rate)
+{
+    m_window = fftwf_alloc_real(m_size);
+    m_input = fftwf_alloc_real(m_size);
+    m_output = fftwf_alloc_complex(bins());
+
+    // Blackman window
+    const double a0 = 0.42;
+    const double a1 = 0.5;
+    const double a2 = 0.08;
+
+    for (int i = 0; i < m_size; ++i) {
+        m_window[i] = static_cast<float>(a0 - a1 * std::cos(2.0 * M_PI * i / (m_size - 1)) +
+                                         a2 * std::cos(4.0 * M_PI * i / (m_size - 1)));
+    }
+
+    buildBands();
+
+    // importing wisdom makes FFTW_MEASURE nearly free after the first run.
+    // the wisdom is only saved again if planning this size added to it
+    const QString wisdom = wisdomPath();
+    fftwf_import_wisdom_from_filename(QFile::encodeName(wisdom).constData());
+
+    const QByteArray before = exportWisdom();
+
+    m_plan = fftwf_plan_dft_r2c_1d(m_size, m_input, m_output, FFTW_MEASURE);
+
+    // measuring scribbles over the buffers
+    std::fill(m_input, m_input + m_size, 0.0f);
+
+    const QByteArray after = exportWisdom();
+
+    if(after == before)
+        return;
+
+    // other wallpaper instances may be importing the file right now, so it
+    // is written aside and renamed over the old one
+    QDir().mkpath(QFileInfo(wisdom).absolutePath());
+
+    QSaveFile file(wisdom);
+
+    if(!file.open(QIODevice::WriteOnly) || file.write(after) != after.size() || !file.commit())
+        qWarning("Could not save FFTW wisdom to %s", qPrintable(wisdom));
+}
+
+QByteArray AudioAnalyzer::exportWisdom()
+{
+    char *text = fftwf_export_wisdom_to_string();
+
+    if(!text)
+        return QByteArray();
+
+    const QByteArray wisdom(text);
+
+    // allocated with malloc by FFTW
+    free(text);
+
+    return wisdom;
+}
+
+AudioAnalyzer::~AudioAnalyzer()
+{
+    if(m_plan)
+        fftwf_destroy_plan(m_plan);
+
+    fftwf_free(m_output);
+    fftwf_free(m_input);
+    fftwf_free(m_window);
+}
+
+int AudioAnalyzer::scaledSize(int size, quint32 rate)
+{
+    const int target = std::max(2, static_cast<int>(std::lround(double(size) * rate / ReferenceRate)));
+
+    auto smooth = [](int n) {
+        for(const int factor : {2, 3, 5, 7})
+        {
+            while(n % factor == 0)
+                n /= factor;
+        }
+
+        return n == 1;
+    };
+
+    // the nearest even 7-smooth size, searching outwards from the target
+    for(int offset = 0;; ++offset)
+    {
+        for(const int candidate : {target - offset, target + offset})
+        {
+            if(candidate >= 2 && candidate % 2 == 0 && smooth(candidate))
+                return candidate;
+        }
+    }
+}
+
+void AudioAnalyzer::execute()
+{
+    fftwf_execute(m_plan);
+}
+
+void AudioAnalyzer::analyze(float timeConstant, float peakFactor, float frameSeconds)
+{
+    /**
+     * To convert the frame to an audio texture we need to:
+     *
+     * Take the fftSize samples of every channel, they are interleaved in the
+     * frame and split once. Each channel then gets the following steps
+     * 1. Calculate wave data
+     * 2. Multiply it with Blackman window
+     * 3. Feed the windowed samples to the real input plan
+     * 4. Apply the Fourier transform, as a result we get fftSize / 2 + 1 FFT bins
+     * 5. Convert complex result into real values using cabs() function
+     * 6. Divide each value by fftSize
+     * 7. Apply smoothing by using previously calculated spectrum values
+     * 8. Map the bins onto the texture columns (linear, log, mel or bark)
+     *    and optionally hold their peaks
+     * 9. Convert resulting values to dB: dB = 20 * log10(v)
+     * 10. Convert floating point dB spectrum into 8-bit values:
+     * 11. Write 8-bit values into texture
+     *
+     * The features are taken from the unsmoothed magnitudes of every channel.
+     */
+
+    // 1
+    const int N = m_size;
+    float *magnitude = m_magnitude.data();
+
+    deinterleave();
+
+    for(int channel = 0; channel < static_cast<int>(m_channels); ++channel)
+    {
+        const float *rawSamples = samples(channel);
+
+        AudioKernels::waveBytes(rawSamples, waveRow(channel), std::min(N, m_textureWidth));
+        AudioKernels::applyWindow(rawSamples, m_window, m_input, N);
+
+        // Step 2 & 3: Apply the planned real to complex transformation.
+        // The input is real, so only the lower N / 2 + 1 bins are produced
+        execute();
+
+        // Step 4: Convert to magnitudes and divide by N
+        AudioKernels::magnitude(output(), magnitude, bins(), 1.0f / N);
+        m_features.add(magnitude, rawSamples);
+
+        // Step 5: Smooth every bin over time, in place on the persistent state
+        AudioKernels::smooth(magnitude, smoothed(channel), bins(), timeConstant);
+
+        // Step 6: Map the bins onto the columns through the precomputed table
+        mapBands(channel);
+
+        const float *spectrum = bands(channel);
+
+        if(peakFactor > 0.0f)
+        {
+            AudioKernels::peakHold(spectrum, peaks(channel), m_textureWidth, peakFactor);
+            spectrum = peaks(channel);
+        }
+
+        // Step 7 & 8: Convert to decibels, clamp between -100dB and 0dB, then map
+        // to 0-255 and write them straight into the texture.
+        const float minDb = -100.0f; // Minimum dB value for clamping
+        AudioKernels::decibelBytes(spectrum, spectrumRow(channel), m_textureWidth, minDb);
+    }
+
+    m_features.update(frameSeconds);
+}
+
+float AudioAnalyzer::convert(const float *source, quint32 sourceChannels, quint64 first, quint64 count, quint32 channels, float *destination)
+{
+    if(channels == 1)
+        AudioKernels::downmix(source + first * sourceChannels, static_cast<quint32>(count), sourceChannels, destination);
+    else if(channels == sourceChannels)
+        std::memcpy(destination, source + first, count * sizeof(float));
+    else
+    {
+        // fewer channels than the source has, only until a reconnect catches up
+        for(quint64 i = 0; i < count; ++i)
+        {
+            const quint64 sample = first + i;
+            destination[i] = source[(sample / channels) * sourceChannels + sample % channels];
+        }
+    }
+
+    return AudioKernels::sumOfSquares(destination, static_cast<int>(count));
+}
+
+void AudioAnalyzer::deinterleave()
+{
+    if(m_channels > 1)
+        AudioKernels::deinterleave(m_frame.data(), m_size, m_channels, m_planar.data());
+}
+
+void AudioAnalyzer::mapBands(int channel)
+{
+    const int lastBin = bins() - 1;
+    const float *spectrum = smoothed(channel);
+    float *destination = bands(channel);
+
+    for(size_t column = 0; column < m_bandTable.size(); ++column)
+    {
+        const Band &band = m_bandTable[column];
+
+        if(band.last < 0)
+        {
+            const float low = spectrum[band.first];
+            const float high = spectrum[std::min(band.first + 1, lastBin)];
+
+            destination[column] = low + (high - low) * band.fraction;
+        }
+        else
+            destination[column] = *std::max_element(spectrum + band.first, spectrum + band.last + 1);
+    }
+}
+
+void AudioAnalyzer::buildBands()
+{
+    const int columns = m_textureWidth;
+    const int lastBin = bins() - 1;
+    const double nyquist = m_rate / 2.0;
+    const double binWidth = double(m_rate) / m_size;
+
+    // linear keeps the ShaderToy layout, the lower half of the spectrum at
+    // the reference rate. at 2048 samples that is exactly one bin per column
+    // of a 512 wide texture
+    double low = 0.0;
+    double high = std::min(ReferenceRate / 4.0, nyquist);
+
+    if(m_mapping != Linear)
+    {
+        high = std::min(MaximumFrequency, nyquist);
+        low = std::min(MinimumFrequency, high / 2.0);
+    }
+
+    const double scaleLow = toScale(m_mapping, low);
+    const double scaleHigh = toScale(m_mapping, high);
+
+    m_bandTable.resize(columns);
+
+    for(int column = 0; column < columns; ++column)
+    {
+        // edges of the column, in fractional bins
+        const double from = fromScale(m_mapping, scaleLow + (scaleHigh - scaleLow) * column / columns) / binWidth;
+        const double to = fromScale(m_mapping, scaleLow + (scaleHigh - scaleLow) * (column + 1) / columns) / binWidth;
+
+        // a column owns the bins in [from, to), the epsilon keeps rounding
+        // noise from pushing an edge that lands on a bin over it
+        Band &band = m_bandTable[column];
+        band.first = std::clamp(static_cast<int>(std::ceil(from - 1e-6)), 0, lastBin);
+        band.last = std::clamp(static_cast<int>(std::ceil(to - 1e-6)) - 1, -1, lastBin);
+
+        // no bin falls inside the column, sample the spectrum at its centre
+        if(band.last < band.first)
+        {
+            const double centre = std::clamp((from + to) / 2.0, 0.0, double(lastBin));
+
+            band.first = static_cast<int>(centre);
+            band.last = -1;
+            band.fraction = static_cast<float>(centre - band.first);
+        }
+    }
+}
+
+QString AudioAnalyzer::wisdomPath()
+{
+    return QStringLiteral("%1/.local/share/komplex/fftwf.wisdom").arg(QStandardPaths::writableLocation(QStandardPaths::HomeLocation));
+}
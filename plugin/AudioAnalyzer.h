@@ -0,0 +1,222 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  AudioAnalyzer.h
+ *
+ *  Holds the FFT state used by AudioModel. An analyzer is created once per
+ *  negotiated stream format and analysis settings, so the realtime process
+ *  callback never has to plan a transform or recompute the window and band
+ *  tables.
+ *
+ *  PipeWire delivers float32 samples, so the single precision fftwf API is
+ *  used all the way through.
+ *
+ *  The analyzer is the whole DSP stage and knows nothing about PipeWire.
+ *  Anything that has interleaved float32 audio, a file or a synthetic
+ *  signal, can convert() it into frame() and call analyze() to get the
+ *  same texture AudioModel publishes.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef AUDIOANALYZER_H
+#define AUDIOANALYZER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+
+#include "AudioFeatures.h"
+
+#include <cmath>
+#include <fftw3.h>
+#include <vector>
+
+class AudioAnalyzer
+{
+public:
+    // sizes and hops are given at this rate and scaled to the analysed one,
+    // so a frame spans the same time and a bin the same width at any rate
+    static constexpr quint32 ReferenceRate = 44100;
+
+    // how the FFT bins are spread over the columns of the spectrum row
+    enum Mapping
+    {
+        Linear, // ShaderToy compatible, 0-11025Hz one bin per column at 2048 samples
+        Logarithmic, // equal width octaves from 20Hz
+        Mel,
+        Bark
+    };
+
+    /**!
+     * @brief AudioAnalyzer
+     * Plans a real-to-complex transform of the given size and precomputes
+     * the Blackman window and the bin to column table. Planning is wisdom
+     * backed, so only the first run on a machine pays for FFTW_MEASURE.
+     *
+     * This must never be called from the realtime thread.
+     *
+     * @param size Number of samples per analysis frame and channel
+     * @param rate Negotiated stream sample rate
+     * @param channels Number of channels analysed separately, each one gets
+     * a spectrum and a waveform row in the texture
+     * @param textureWidth Width of the 8-bit texture frames are written to
+     * @param mapping Frequency scale of the spectrum rows
+     */
+    AudioAnalyzer(int size, quint32 rate, quint32 channels, int textureWidth, Mapping mapping = Linear);
+    ~AudioAnalyzer();
+
+    AudioAnalyzer(const AudioAnalyzer &) = delete;
+    AudioAnalyzer &operator=(const AudioAnalyzer &) = delete;
+
+    int size() const { return m_size; }
+    int bins() const { return m_size / 2 + 1; }
+    quint32 rate() const { return m_rate; }
+    quint32 channels() const { return m_channels; }
+    int textureWidth() const { return m_textureWidth; }
+    QSize textureSize() const { return QSize(m_textureWidth, m_channels * 2); }
+    Mapping mapping() const { return m_mapping; }
+
+    const float *window() const { return m_window; }
+    float *input() { return m_input; }
+    float *magnitude() { return m_magnitude.data(); }
+
+    // interleaved frame of size() * channels() samples read from the ring buffer
+    float *frame() { return m_frame.data(); }
+
+    // samples of one channel of frame(), valid after deinterleave()
+    float *samples(int channel) { return m_channels == 1 ? m_frame.data() : m_planar.data() + channel * m_size; }
+
+    // magnitude() smoothed over time. persists from frame to frame, so it
+    // only starts from silence when the analyzer is rebuilt
+    float *smoothed(int channel) { return m_smoothed.data() + channel * bins(); }
+
+    // smoothed() remapped to one value per texture column by mapBands()
+    float *bands(int channel) { return m_bands.data() + channel * m_textureWidth; }
+
+    // decaying maximum of bands(), persistent like smoothed()
+    float *peaks(int channel) { return m_peaks.data() + channel * m_textureWidth; }
+
+    // scratch texture the frame is built in before it is published, row major
+    // 8-bit. every channel has a spectrum row followed by a waveform row
+    uchar *texture() { return m_texture.data(); }
+    uchar *spectrumRow(int channel) { return m_texture.data() + channel * 2 * m_textureWidth; }
+    uchar *waveRow(int channel) { return spectrumRow(channel) + m_textureWidth; }
+
+    // interleaved real and imaginary parts of bins() complex values
+    const float *output() const { return reinterpret_cast<const float *>(m_output); }
+
+    /**!
+     * @brief scaledSize
+     * Transform size at rate that covers the same time as size samples at
+     * ReferenceRate. Rounded to a size FFTW handles well, only factors of 2,
+     * 3, 5 and 7.
+     */
+    static int scaledSize(int size, quint32 rate);
+
+    // samples at rate() covering the same time as samples at ReferenceRate
+    int scaled(int samples) const { return std::max(1, static_cast<int>(std::lround(double(samples) * m_rate / ReferenceRate))); }
+
+    /**!
+     * @brief execute
+     * Runs the transform of input() into output(). Safe to call from the
+     * realtime thread, it does not allocate.
+     */
+    void execute();
+
+    /**!
+     * @brief analyze
+     * Runs one analysis frame on frame() and builds texture() from it. Does
+     * not allocate.
+     *
+     * @param timeConstant Spectrum smoothing, see AudioModel::smoothingTimeConstant
+     * @param peakFactor Linear factor the held peaks fall by per frame, 0
+     * disables peak hold
+     * @param frameSeconds Time since the previous frame, for features()
+     */
+    void analyze(float timeConstant, float peakFactor, float frameSeconds);
+
+    // derived from the frame by analyze()
+    const AudioFeatures::Values &features() const { return m_features.values(); }
+
+    /**!
+     * @brief convert
+     * Converts interleaved float32 samples of sourceChannels channels into
+     * the analysed layout of channels channels: a mono downmix, a straight
+     * copy, or the leading channels when the source has more. Positions are
+     * counted in converted samples, so a conversion can be split anywhere,
+     * for example where a ring buffer wraps. Safe to call from the realtime
+     * thread.
+     *
+     * @param first First converted sample to write
+     * @param count Number of converted samples to write
+     *
+     * @return sum of the squares of the written samples
+     */
+    static float convert(const float *source, quint32 sourceChannels, quint64 first, quint64 count, quint32 channels, float *destination);
+
+    /**!
+     * @brief deinterleave
+     * Splits frame() into samples(), a single pass over the frame. Nothing to
+     * do for a single channel.
+     */
+    void deinterleave();
+
+    /**!
+     * @brief mapBands
+     * Reduces smoothed() into bands() through the precomputed table. Columns
+     * spanning several bins take the loudest one, columns narrower than a bin
+     * interpolate between its neighbours.
+     */
+    void mapBands(int channel);
+
+private:
+    struct Band
+    {
+        int first = 0; // first bin of the column
+        int last = -1; // last bin of the column, or -1 to interpolate
+        float fraction = 0.0f; // weight of first + 1 when interpolating
+    };
+
+    void buildBands();
+
+    static QString wisdomPath();
+
+    // the accumulated FFTW wisdom as text
+    static QByteArray exportWisdom();
+
+    int m_size = 0;
+    quint32 m_rate = 0;
+    quint32 m_channels = 0;
+    int m_textureWidth = 0;
+    Mapping m_mapping = Linear;
+
+    std::vector<float> m_frame;
+    std::vector<float> m_planar; // one block of size() samples per channel, unused for mono
+    std::vector<float> m_magnitude;
+    std::vector<float> m_smoothed;
+    std::vector<float> m_bands;
+    std::vector<float> m_peaks;
+    std::vector<Band> m_bandTable;
+    std::vector<uchar> m_texture;
+    AudioFeatures m_features;
+    float *m_window = nullptr;
+    float *m_input = nullptr;
+    fftwf_complex *m_output = nullptr;
+    fftwf_plan m_plan = nullptr;
+};
+
+#endif // AUDIOANALYZER_H
@@ -0,0 +1,101 @@
+#include "AudioDecimator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+
+AudioDecimator::AudioDecimator()
+{
+    for(int factor = 2; factor <= MaximumFactor; ++factor)
+    {
+        const int taps = TapsPerFactor * factor;
+        std::vector<float> &filter = m_filters[factor];
+
+        filter.resize(taps);
+
+        // cut off a little below the new nyquist, the top of the band is
+        // far above anything the texture maps anyway
+        const double cutoff = 0.45 / factor;
+        const double centre = (taps - 1) / 2.0;
+        double sum = 0.0;
+
+        for(int i = 0; i < taps; ++i)
+        {
+            const double x = i - centre;
+            const double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+            const double window = 0.42 - 0.5 * std::cos(2.0 * M_PI * i / (taps - 1)) + 0.08 * std::cos(4.0 * M_PI * i / (taps - 1));
+
+            filter[i] = static_cast<float>(sinc * window);
+            sum += filter[i];
+        }
+
+        // unity gain at DC
+        for(float &tap : filter)
+            tap = static_cast<float>(tap / sum);
+    }
+}
+
+int AudioDecimator::factorFor(quint32 rate)
+{
+    return std::clamp(static_cast<int>((rate + MaximumAnalysisRate - 1) / MaximumAnalysisRate), 1, MaximumFactor);
+}
+
+void AudioDecimator::reset(int factor, quint32 channels)
+{
+    m_factor = std::clamp(factor, 1, MaximumFactor);
+    m_channels = std::clamp<quint32>(channels, 1, MaximumChannels);
+    m_phase = 0;
+    m_position = 0;
+
+    std::memset(m_history, 0, sizeof(m_history));
+}
+
+quint64 AudioDecimator::process(const float *source, quint64 frames, float *destination)
+{
+    if(m_factor == 1)
+    {
+        std::memcpy(destination, source, frames * m_channels * sizeof(float));
+        return frames;
+    }
+
+    const std::vector<float> &filter = m_filters[m_factor];
+    const int taps = static_cast<int>(filter.size());
+    quint64 written = 0;
+
+    for(quint64 frame = 0; frame < frames; ++frame)
+    {
+        // the newest sample goes in at the position and taps further on,
+        // the window the filter reads is [position + 1, position + taps]
+        m_position = m_position + 1 == taps ? 0 : m_position + 1;
+
+        for(quint32 channel = 0; channel < m_channels; ++channel)
+        {
+            const float sample = source[frame * m_channels + channel];
+
+            m_history[channel][m_position] = sample;
+            m_history[channel][m_position + taps] = sample;
+        }
+
+        if(++m_phase < m_factor)
+            continue;
+
+        m_phase = 0;
+
+        // the filter is symmetric, so it does not matter which end of the
+        // window counts as the newest sample
+        for(quint32 channel = 0; channel < m_channels; ++channel)
+        {
+            const float *window = m_history[channel] + m_position + 1;
+            float sum = 0.0f;
+
+            for(int i = 0; i < taps; ++i)
+                sum += filter[i] * window[i];
+
+            destination[written * m_channels + channel] = sum;
+        }
+
+        ++written;
+    }
+
+    return written;
+}
@@ -0,0 +1,98 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  AudioDecimator.h
+ *
+ *  Integer factor polyphase decimator for the captured audio. Graph rates
+ *  well above the analysis reference rate (88.2kHz, 96kHz, 192kHz) are
+ *  brought back near it before the samples reach the ring buffer, so the
+ *  FFT never pays for bandwidth the texture cannot show.
+ *
+ *  Only every factor-th output of the anti-aliasing FIR is computed, which
+ *  is all a polyphase decimator is. The filter is a Blackman windowed sinc
+ *  of TapsPerFactor taps per unit of the factor.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef AUDIODECIMATOR_H
+#define AUDIODECIMATOR_H
+
+#include <QtGlobal>
+
+#include <array>
+#include <vector>
+
+class AudioDecimator
+{
+public:
+    static constexpr int MaximumFactor = 8;
+    static constexpr int MaximumChannels = 8;
+    static constexpr int TapsPerFactor = 16;
+    static constexpr int MaximumTaps = TapsPerFactor * MaximumFactor;
+
+    // graph rates are decimated until they are at or below this
+    static constexpr quint32 MaximumAnalysisRate = 50000;
+
+    /**!
+     * @brief AudioDecimator
+     * Builds the filters of every factor up front, so switching between
+     * them never allocates.
+     */
+    AudioDecimator();
+
+    /**!
+     * @brief factorFor
+     * Decimation factor used for a graph rate, 1 for the common 44.1kHz and
+     * 48kHz rates.
+     */
+    static int factorFor(quint32 rate);
+
+    /**!
+     * @brief reset
+     * Switches the factor and channel count and clears the filter history.
+     * Safe to call from the realtime thread.
+     */
+    void reset(int factor, quint32 channels);
+
+    int factor() const { return m_factor; }
+    quint32 channels() const { return m_channels; }
+
+    /**!
+     * @brief process
+     * Decimates interleaved frames of channels() channels. The phase and the
+     * filter history carry over between calls, so a stream can be fed in
+     * pieces of any size. Safe to call from the realtime thread.
+     *
+     * @param destination Room for at least frames / factor() + 1 frames
+     *
+     * @return number of frames written to destination
+     */
+    quint64 process(const float *source, quint64 frames, float *destination);
+
+private:
+    std::array<std::vector<float>, MaximumFactor + 1> m_filters;
+
+    int m_factor = 1;
+    quint32 m_channels = 1;
+    int m_phase = 0;
+    int m_position = 0;
+
+    // the history of every channel is stored twice in a row, so the newest
+    // taps samples are always contiguous whatever the position
+    float m_history[MaximumChannels][2 * MaximumTaps] = {};
+};
+
+#endif // AUDIODECIMATOR_H
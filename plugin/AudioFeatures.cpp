@@ -0,0 +1,235 @@
+#include "AudioFeatures.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+// band edges in Hz, sub bass, bass, mid and treble
+constexpr double BandEdges[] = { 20.0, 60.0, 250.0, 4000.0, 20000.0 };
+
+// an onset has to rise this many standard deviations above the recent flux
+constexpr float OnsetDeviations = 1.5f;
+constexpr float MinimumOnsetFlux = 0.01f;
+constexpr float MinimumOnsetInterval = 0.1f;
+
+// the flux mean and variance follow about this many seconds
+constexpr float FluxMemory = 1.0f;
+
+constexpr float MinimumBpm = 60.0f;
+constexpr float MaximumBpm = 200.0f;
+constexpr float PreferredBpm = 120.0f; // breaks ties between a tempo and its double or half
+constexpr int TempoInterval = 16; // frames between two tempo estimates
+
+// how far an onset pulls the beat phase towards itself
+constexpr float PhaseCorrection = 0.25f;
+}
+
+AudioFeatures::AudioFeatures(int size, quint32 rate)
+    : m_size(size),
+    m_magnitude(size / 2 + 1, 0.0f),
+    m_levels(size / 2 + 1, 0.0f),
+    m_history(HistorySize, 0.0f)
+{
+    const int lastBin = size / 2;
+
+    // every band gets at least one bin, small transforms have few below 250Hz
+    for(size_t band = 0; band < m_bandEdges.size(); ++band)
+    {
+        const int edge = static_cast<int>(std::lround(BandEdges[band] * size / rate));
+        const int minimum = band > 0 ? m_bandEdges[band - 1] + 1 : 1;
+
+        m_bandEdges[band] = std::clamp(std::max(edge, minimum), 1, lastBin + 1);
+    }
+}
+
+float AudioFeatures::level(float meanSquare)
+{
+    if(meanSquare <= 0.0f)
+        return 0.0f;
+
+    return std::clamp((10.0f * std::log10(meanSquare) + 100.0f) / 100.0f, 0.0f, 1.0f);
+}
+
+void AudioFeatures::add(const float *magnitude, const float *samples)
+{
+    const int bins = static_cast<int>(m_magnitude.size());
+
+    if(m_channels == 0)
+    {
+        std::copy(magnitude, magnitude + bins, m_magnitude.begin());
+        m_energy = 0.0f;
+    }
+    else
+    {
+        for(int bin = 0; bin < bins; ++bin)
+            m_magnitude[bin] += magnitude[bin];
+    }
+
+    for(int i = 0; i < m_size; ++i)
+        m_energy += samples[i] * samples[i];
+
+    ++m_channels;
+}
+
+void AudioFeatures::update(float frameSeconds)
+{
+    if(m_channels == 0)
+        return;
+
+    const int bins = static_cast<int>(m_magnitude.size());
+    const float scale = 1.0f / m_channels;
+
+    // channel mean of the magnitudes from here on
+    for(int bin = 0; bin < bins; ++bin)
+        m_magnitude[bin] *= scale;
+
+    float *bands[] = { &m_values.subBass, &m_values.bass, &m_values.mid, &m_values.treble };
+
+    for(int band = 0; band < 4; ++band)
+    {
+        const int first = m_bandEdges[band];
+        const int last = m_bandEdges[band + 1];
+        float sum = 0.0f;
+
+        for(int bin = first; bin < last; ++bin)
+            sum += m_magnitude[bin] * m_magnitude[bin];
+
+        *bands[band] = last > first ? level(sum / (last - first)) : 0.0f;
+    }
+
+    m_values.loudness = level(m_energy * scale / m_size);
+
+    // spectral flux, only rising bins count. measured on the level scale so
+    // quiet passages produce onsets as well as loud ones
+    float flux = 0.0f;
+
+    for(int bin = 0; bin < bins; ++bin)
+    {
+        const float current = level(m_magnitude[bin] * m_magnitude[bin]);
+
+        flux += std::max(current - m_levels[bin], 0.0f);
+        m_levels[bin] = current;
+    }
+
+    flux /= bins;
+    m_values.flux = flux;
+
+    // adaptive threshold, an onset stands out from the flux around it
+    const float deviation = flux - m_fluxMean;
+    const bool onset = m_sinceOnset >= MinimumOnsetInterval && flux > MinimumOnsetFlux && deviation > OnsetDeviations * std::sqrt(m_fluxVariance);
+    const float alpha = std::min(frameSeconds / FluxMemory, 1.0f);
+
+    m_fluxMean += alpha * deviation;
+    m_fluxVariance = (1.0f - alpha) * (m_fluxVariance + alpha * deviation * deviation);
+    m_sinceOnset = onset ? 0.0f : m_sinceOnset + frameSeconds;
+    m_values.onset = onset ? 1.0f : 0.0f;
+
+    m_history[m_historyPosition] = flux;
+    m_historyPosition = (m_historyPosition + 1) % HistorySize;
+    m_historyCount = std::min(m_historyCount + 1, HistorySize);
+
+    if(--m_framesUntilTempo <= 0)
+    {
+        updateTempo(frameSeconds);
+        m_framesUntilTempo = TempoInterval;
+    }
+
+    // the phase runs freely at the estimated tempo and every onset nudges it
+    // towards a beat
+    if(m_values.bpm > 0.0f)
+    {
+        float phase = m_values.beatPhase + frameSeconds * m_values.bpm / 60.0f;
+
+        if(onset)
+            phase -= PhaseCorrection * (phase - std::round(phase));
+
+        m_values.beatPhase = phase - std::floor(phase);
+    }
+    else
+        m_values.beatPhase = 0.0f;
+
+    m_channels = 0;
+}
+
+void AudioFeatures::updateTempo(float frameSeconds)
+{
+    const int minimumLag = std::max(1, static_cast<int>(std::floor(60.0f / (MaximumBpm * frameSeconds))));
+    const int maximumLag = std::min(static_cast<int>(std::ceil(60.0f / (MinimumBpm * frameSeconds))), m_historyCount / 2);
+
+    // not enough history for a couple of beats at the slowest tempo
+    if(frameSeconds <= 0.0f || maximumLag <= minimumLag + 1)
+    {
+        m_values.bpm = 0.0f;
+        return;
+    }
+
+    const int oldest = (m_historyPosition - m_historyCount + HistorySize) % HistorySize;
+    auto at = [this, oldest](int i) { return m_history[(oldest + i) % HistorySize]; };
+
+    float mean = 0.0f;
+
+    for(int i = 0; i < m_historyCount; ++i)
+        mean += at(i);
+
+    mean /= m_historyCount;
+
+    auto correlation = [&](int lag) {
+        float sum = 0.0f;
+
+        for(int i = 0; i + lag < m_historyCount; ++i)
+            sum += (at(i) - mean) * (at(i + lag) - mean);
+
+        return sum / (m_historyCount - lag);
+    };
+
+    const float energy = correlation(0);
+
+    if(energy <= 0.0f)
+    {
+        m_values.bpm = 0.0f;
+        return;
+    }
+
+    int bestLag = 0;
+    float bestScore = 0.0f;
+    float previous = correlation(minimumLag - 1);
+    float current = correlation(minimumLag);
+
+    // only local maxima are candidates, weighted towards the preferred tempo
+    for(int lag = minimumLag; lag <= maximumLag; ++lag)
+    {
+        const float next = correlation(lag + 1);
+
+        if(current > previous && current >= next)
+        {
+            const float octaves = std::log2(60.0f / (lag * frameSeconds) / PreferredBpm);
+            const float score = current * std::exp(-0.5f * octaves * octaves);
+
+            if(score > bestScore)
+            {
+                bestScore = score;
+                bestLag = lag;
+            }
+        }
+
+        previous = current;
+        current = next;
+    }
+
+    // a weak peak means there is no steady beat to follow
+    if(bestLag == 0 || correlation(bestLag) < 0.1f * energy)
+    {
+        m_values.bpm = 0.0f;
+        return;
+    }
+
+    // parabolic interpolation between the neighbouring lags
+    const float left = correlation(bestLag - 1);
+    const float centre = correlation(bestLag);
+    const float right = correlation(bestLag + 1);
+    const float curvature = left - 2.0f * centre + right;
+    const float offset = curvature < 0.0f ? 0.5f * (left - right) / curvature : 0.0f;
+
+    m_values.bpm = 60.0f / ((bestLag + std::clamp(offset, -0.5f, 0.5f)) * frameSeconds);
+}
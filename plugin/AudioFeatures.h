@@ -0,0 +1,115 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  AudioFeatures.h
+ *
+ *  A handful of values derived from every analysis frame, so shaders can
+ *  react to bass, beats or loudness through a uniform instead of sampling
+ *  the audio texture over and over in every fragment.
+ *
+ *  Levels use the same -100dB to 0dB scale as the spectrum row, mapped to
+ *  0-1. Onsets come from the spectral flux against an adaptive threshold,
+ *  the tempo from the autocorrelation of the flux over the last few
+ *  seconds.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef AUDIOFEATURES_H
+#define AUDIOFEATURES_H
+
+#include <QtGlobal>
+
+#include <array>
+#include <vector>
+
+class AudioFeatures
+{
+public:
+    // plain data, it is copied through the frame seqlocks and shared memory as is
+    struct Values
+    {
+        float subBass = 0.0f; // RMS of 20-60Hz
+        float bass = 0.0f; // RMS of 60-250Hz
+        float mid = 0.0f; // RMS of 250Hz-4kHz
+        float treble = 0.0f; // RMS of 4kHz-20kHz
+        float flux = 0.0f; // mean rise of the spectrum since the previous frame
+        float bpm = 0.0f; // tempo estimate, 0 until there is a steady one
+        float beatPhase = 0.0f; // runs from 0 at a beat to 1 at the next one
+        float loudness = 0.0f; // RMS of the samples of every channel
+        float onset = 0.0f; // 1 on frames with an onset, 0 otherwise
+    };
+
+    /**!
+     * @brief AudioFeatures
+     * Sizes the state for the given transform. Never called from the
+     * realtime thread.
+     *
+     * @param size Samples per analysis frame
+     * @param rate Sample rate the frames were captured at
+     */
+    AudioFeatures(int size, quint32 rate);
+
+    /**!
+     * @brief add
+     * Accumulates one channel of the current frame.
+     *
+     * @param magnitude size / 2 + 1 bin magnitudes, before any smoothing
+     * @param samples size samples the magnitudes were taken from
+     */
+    void add(const float *magnitude, const float *samples);
+
+    /**!
+     * @brief update
+     * Turns the channels added since the last call into values(). Does not
+     * allocate.
+     *
+     * @param frameSeconds Time between the start of this frame and the previous one
+     */
+    void update(float frameSeconds);
+
+    const Values &values() const { return m_values; }
+
+private:
+    // 0-1 on the spectrum row scale, from a mean square
+    static float level(float meanSquare);
+
+    void updateTempo(float frameSeconds);
+
+    // flux history length, a bit under 6 seconds at the default 512 sample hop
+    static constexpr int HistorySize = 512;
+
+    int m_size = 0;
+    int m_channels = 0;
+
+    std::array<int, 5> m_bandEdges {}; // first bin of every band, and one past the last
+    std::vector<float> m_magnitude; // channel mean of the current frame
+    std::vector<float> m_levels; // previous frame per bin, for the flux
+    float m_energy = 0.0f;
+
+    // adaptive onset threshold, running mean and variance of the flux
+    float m_fluxMean = 0.0f;
+    float m_fluxVariance = 0.0f;
+    float m_sinceOnset = 0.0f;
+
+    std::vector<float> m_history;
+    int m_historyPosition = 0;
+    int m_historyCount = 0;
+    int m_framesUntilTempo = 0;
+
+    Values m_values;
+};
+
+#endif // AUDIOFEATURES_H
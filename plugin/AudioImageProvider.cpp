@@ -1,16 +1,18 @@
 #include "AudioImageProvider.h"
 
 AudioImageProvider::AudioImageProvider() 
-    : QQuickImageProvider(QQuickImageProvider::Pixmap) {}
+    : QQuickImageProvider(QQuickImageProvider::Image) {}
 
-QPixmap AudioImageProvider::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
+QImage AudioImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
 {
     Q_UNUSED(id) // id is useless here. we always want to return the latest frame from AudioModel
     Q_UNUSED(requestedSize) // requested size is useless too. texture must always be 512x2
 
+    //return the latest frame
+    const QImage frame = AudioModel::frame();
+
     if(size)
-        *size = AudioModel::frame().size();
+        *size = frame.size();
 
-    //return the latest frame
-    return AudioModel::frame();
+    return frame;
 }
\ No newline at end of file
@@ -1,7 +1,7 @@
 #ifndef AUDIOIMAGEPROVIDER_H
 #define AUDIOIMAGEPROVIDER_H
 #include <QObject>
-#include <QPixmap>
+#include <QImage>
 #include <QQuickImageProvider>
 
 #include "AudioModel.h"
@@ -12,7 +12,7 @@ class KOMPLEX_EXPORT AudioImageProvider : public QQuickImageProvider
     public:
         explicit AudioImageProvider();
 
-        QPixmap requestPixmap(const QString &id, QSize *size, const QSize &requestedSize) override;
+        QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
 };
 
 #endif
\ No newline at end of file
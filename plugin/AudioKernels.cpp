@@ -0,0 +1,814 @@
+#include "AudioKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KOMPLEX_KERNELS_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define KOMPLEX_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace AudioKernels
+{
+// 20 * log10(2), converts log2 to dB
+static constexpr float DecibelsPerOctave = 6.0205999132796239f;
+
+// magnitudes below this are well under any useful minDb and keep log2 away from denormals
+static constexpr float MagnitudeFloor = 1e-20f;
+
+// the waveform formula overflows the int conversion long before this
+static constexpr float WaveLimit = 4.0f;
+
+/*
+ * Scalar reference implementation
+ */
+void Scalar::downmix(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    if(channels == 0)
+        return;
+
+    const float scale = 1.0f / channels;
+
+    for(quint32 frame = 0; frame < frames; ++frame)
+    {
+        float sum = 0.0f;
+
+        for(quint32 channel = 0; channel < channels; ++channel)
+            sum += interleaved[frame * channels + channel];
+
+        destination[frame] = sum * scale;
+    }
+}
+
+void Scalar::deinterleave(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    for(quint32 channel = 0; channel < channels; ++channel)
+    {
+        float *plane = destination + channel * frames;
+
+        for(quint32 frame = 0; frame < frames; ++frame)
+            plane[frame] = interleaved[frame * channels + channel];
+    }
+}
+
+float Scalar::sumOfSquares(const float *samples, int count)
+{
+    float sum = 0.0f;
+
+    for(int i = 0; i < count; ++i)
+        sum += samples[i] * samples[i];
+
+    return sum;
+}
+
+void Scalar::applyWindow(const float *samples, const float *window, float *destination, int count)
+{
+    for(int i = 0; i < count; ++i)
+        destination[i] = samples[i] * window[i];
+}
+
+void Scalar::magnitude(const float *spectrum, float *destination, int bins, float scale)
+{
+    for(int i = 0; i < bins; ++i)
+    {
+        const float real = spectrum[i * 2];
+        const float imag = spectrum[i * 2 + 1];
+        destination[i] = std::sqrt(real * real + imag * imag) * scale;
+    }
+}
+
+void Scalar::smooth(const float *magnitude, float *state, int count, float timeConstant)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        const float value = timeConstant * state[i] + (1.0f - timeConstant) * magnitude[i];
+        state[i] = std::isfinite(value) ? value : 0.0f;
+    }
+}
+
+void Scalar::peakHold(const float *values, float *peaks, int count, float decay)
+{
+    for(int i = 0; i < count; ++i)
+        peaks[i] = std::max(peaks[i] * decay, values[i]);
+}
+
+void Scalar::decibelBytes(const float *magnitude, uchar *destination, int count, float minDb)
+{
+    const float scale = 255.0f / -minDb;
+
+    for(int i = 0; i < count; ++i)
+    {
+        const float db = magnitude[i] > 0.0f ? 20.0f * std::log10(magnitude[i]) : minDb;
+        const float clamped = std::clamp(db, minDb, 0.0f);
+        destination[i] = static_cast<uchar>((clamped - minDb) * scale);
+    }
+}
+
+void Scalar::waveBytes(const float *samples, uchar *destination, int count)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        const float sample = std::clamp(samples[i], -WaveLimit, WaveLimit);
+        destination[i] = static_cast<uchar>(std::clamp(static_cast<int>(128 * sample + 1) * 2, 0, 255));
+    }
+}
+
+#if defined(KOMPLEX_KERNELS_X86)
+/*
+ * SSE2
+ */
+namespace SSE2
+{
+// log2(x) for positive normal x. The mantissa term uses the atanh series,
+// which is accurate to ~1e-6 over [1, 2)
+static inline __m128 log2(__m128 x)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i bits = _mm_castps_si128(x);
+
+    const __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    const __m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+    const __m128 t = _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one));
+    const __m128 t2 = _mm_mul_ps(t, t);
+
+    __m128 poly = _mm_set1_ps(0.41219858f); // 2 / (7 ln 2)
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set1_ps(0.57707801f)); // 2 / (5 ln 2)
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set1_ps(0.96179669f)); // 2 / (3 ln 2)
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set1_ps(2.88539008f)); // 2 / ln 2
+
+    return _mm_add_ps(exponent, _mm_mul_ps(poly, t));
+}
+
+static inline __m128i decibelInts(__m128 magnitude, __m128 minDb, __m128 scale)
+{
+    const __m128 db = _mm_mul_ps(log2(_mm_max_ps(magnitude, _mm_set1_ps(MagnitudeFloor))), _mm_set1_ps(DecibelsPerOctave));
+    const __m128 clamped = _mm_min_ps(_mm_max_ps(db, minDb), _mm_setzero_ps());
+
+    return _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(clamped, minDb), scale));
+}
+
+static inline __m128i waveInts(__m128 sample)
+{
+    const __m128 clamped = _mm_min_ps(_mm_max_ps(sample, _mm_set1_ps(-WaveLimit)), _mm_set1_ps(WaveLimit));
+    const __m128i value = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(128.0f)), _mm_set1_ps(1.0f)));
+
+    return _mm_add_epi32(value, value);
+}
+
+// saturating packs clamp to 0-255 for us
+static inline void storeBytes(uchar *destination, __m128i a, __m128i b, __m128i c, __m128i d)
+{
+    const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination), bytes);
+}
+
+static void downmix(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    if(channels != 2)
+    {
+        if(channels == 1)
+            std::memcpy(destination, interleaved, frames * sizeof(float));
+        else
+            Scalar::downmix(interleaved, frames, channels, destination);
+
+        return;
+    }
+
+    const __m128 half = _mm_set1_ps(0.5f);
+    quint32 frame = 0;
+
+    for(; frame + 4 <= frames; frame += 4)
+    {
+        const __m128 a = _mm_loadu_ps(interleaved + frame * 2);
+        const __m128 b = _mm_loadu_ps(interleaved + frame * 2 + 4);
+        const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(destination + frame, _mm_mul_ps(_mm_add_ps(left, right), half));
+    }
+
+    Scalar::downmix(interleaved + frame * 2, frames - frame, channels, destination + frame);
+}
+
+static void deinterleave(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    if(channels != 2)
+    {
+        if(channels == 1)
+            std::memcpy(destination, interleaved, frames * sizeof(float));
+        else
+            Scalar::deinterleave(interleaved, frames, channels, destination);
+
+        return;
+    }
+
+    float *left = destination;
+    float *right = destination + frames;
+    quint32 frame = 0;
+
+    for(; frame + 4 <= frames; frame += 4)
+    {
+        const __m128 a = _mm_loadu_ps(interleaved + frame * 2);
+        const __m128 b = _mm_loadu_ps(interleaved + frame * 2 + 4);
+
+        _mm_storeu_ps(left + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    for(; frame < frames; ++frame)
+    {
+        left[frame] = interleaved[frame * 2];
+        right[frame] = interleaved[frame * 2 + 1];
+    }
+}
+
+static float sumOfSquares(const float *samples, int count)
+{
+    __m128 sum = _mm_setzero_ps();
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128 value = _mm_loadu_ps(samples + i);
+        sum = _mm_add_ps(sum, _mm_mul_ps(value, value));
+    }
+
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    return _mm_cvtss_f32(sum) + Scalar::sumOfSquares(samples + i, count - i);
+}
+
+static void applyWindow(const float *samples, const float *window, float *destination, int count)
+{
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+        _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(window + i)));
+
+    Scalar::applyWindow(samples + i, window + i, destination + i, count - i);
+}
+
+static void magnitude(const float *spectrum, float *destination, int bins, float scale)
+{
+    const __m128 factor = _mm_set1_ps(scale);
+    int i = 0;
+
+    for(; i + 4 <= bins; i += 4)
+    {
+        __m128 a = _mm_loadu_ps(spectrum + i * 2);
+        __m128 b = _mm_loadu_ps(spectrum + i * 2 + 4);
+        a = _mm_mul_ps(a, a);
+        b = _mm_mul_ps(b, b);
+
+        const __m128 sum = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_sqrt_ps(sum), factor));
+    }
+
+    Scalar::magnitude(spectrum + i * 2, destination + i, bins - i, scale);
+}
+
+static void smooth(const float *magnitude, float *state, int count, float timeConstant)
+{
+    const __m128 previous = _mm_set1_ps(timeConstant);
+    const __m128 current = _mm_set1_ps(1.0f - timeConstant);
+    const __m128 absolute = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(state + i), previous), _mm_mul_ps(_mm_loadu_ps(magnitude + i), current));
+
+        // NaN compares false as well, so both end up 0
+        _mm_storeu_ps(state + i, _mm_and_ps(value, _mm_cmplt_ps(_mm_and_ps(value, absolute), infinity)));
+    }
+
+    Scalar::smooth(magnitude + i, state + i, count - i, timeConstant);
+}
+
+static void peakHold(const float *values, float *peaks, int count, float decay)
+{
+    const __m128 factor = _mm_set1_ps(decay);
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+        _mm_storeu_ps(peaks + i, _mm_max_ps(_mm_loadu_ps(values + i), _mm_mul_ps(_mm_loadu_ps(peaks + i), factor)));
+
+    Scalar::peakHold(values + i, peaks + i, count - i, decay);
+}
+
+static void decibelBytes(const float *magnitude, uchar *destination, int count, float minDb)
+{
+    const __m128 floor = _mm_set1_ps(minDb);
+    const __m128 scale = _mm_set1_ps(255.0f / -minDb);
+    int i = 0;
+
+    for(; i + 16 <= count; i += 16)
+    {
+        storeBytes(destination + i,
+                   decibelInts(_mm_loadu_ps(magnitude + i), floor, scale),
+                   decibelInts(_mm_loadu_ps(magnitude + i + 4), floor, scale),
+                   decibelInts(_mm_loadu_ps(magnitude + i + 8), floor, scale),
+                   decibelInts(_mm_loadu_ps(magnitude + i + 12), floor, scale));
+    }
+
+    Scalar::decibelBytes(magnitude + i, destination + i, count - i, minDb);
+}
+
+static void waveBytes(const float *samples, uchar *destination, int count)
+{
+    int i = 0;
+
+    for(; i + 16 <= count; i += 16)
+    {
+        storeBytes(destination + i,
+                   waveInts(_mm_loadu_ps(samples + i)),
+                   waveInts(_mm_loadu_ps(samples + i + 4)),
+                   waveInts(_mm_loadu_ps(samples + i + 8)),
+                   waveInts(_mm_loadu_ps(samples + i + 12)));
+    }
+
+    Scalar::waveBytes(samples + i, destination + i, count - i);
+}
+}
+
+/*
+ * AVX2
+ */
+#define KOMPLEX_AVX2 __attribute__((target("avx2,fma")))
+
+namespace AVX2
+{
+KOMPLEX_AVX2 static inline __m256 log2(__m256 x)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i bits = _mm256_castps_si256(x);
+
+    const __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    const __m256 mantissa =
+        _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+
+    const __m256 t = _mm256_div_ps(_mm256_sub_ps(mantissa, one), _mm256_add_ps(mantissa, one));
+    const __m256 t2 = _mm256_mul_ps(t, t);
+
+    __m256 poly = _mm256_set1_ps(0.41219858f);
+    poly = _mm256_fmadd_ps(poly, t2, _mm256_set1_ps(0.57707801f));
+    poly = _mm256_fmadd_ps(poly, t2, _mm256_set1_ps(0.96179669f));
+    poly = _mm256_fmadd_ps(poly, t2, _mm256_set1_ps(2.88539008f));
+
+    return _mm256_fmadd_ps(poly, t, exponent);
+}
+
+KOMPLEX_AVX2 static inline __m256i decibelInts(__m256 magnitude, __m256 minDb, __m256 scale)
+{
+    const __m256 db = _mm256_mul_ps(log2(_mm256_max_ps(magnitude, _mm256_set1_ps(MagnitudeFloor))), _mm256_set1_ps(DecibelsPerOctave));
+    const __m256 clamped = _mm256_min_ps(_mm256_max_ps(db, minDb), _mm256_setzero_ps());
+
+    return _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(clamped, minDb), scale));
+}
+
+KOMPLEX_AVX2 static inline __m256i waveInts(__m256 sample)
+{
+    const __m256 clamped = _mm256_min_ps(_mm256_max_ps(sample, _mm256_set1_ps(-WaveLimit)), _mm256_set1_ps(WaveLimit));
+    const __m256i value = _mm256_cvttps_epi32(_mm256_fmadd_ps(clamped, _mm256_set1_ps(128.0f), _mm256_set1_ps(1.0f)));
+
+    return _mm256_add_epi32(value, value);
+}
+
+// the 256 bit packs work per 128 bit lane, the permute puts the 4 byte groups back in order
+KOMPLEX_AVX2 static inline void storeBytes(uchar *destination, __m256i a, __m256i b, __m256i c, __m256i d)
+{
+    const __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination), _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+}
+
+// hadd works per lane as well, this restores the order of the pairwise sums
+KOMPLEX_AVX2 static inline __m256 pairSums(__m256 a, __m256 b)
+{
+    const __m256 sums = _mm256_hadd_ps(a, b);
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sums), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+KOMPLEX_AVX2 static void downmix(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    if(channels != 2)
+    {
+        SSE2::downmix(interleaved, frames, channels, destination);
+        return;
+    }
+
+    const __m256 half = _mm256_set1_ps(0.5f);
+    quint32 frame = 0;
+
+    for(; frame + 8 <= frames; frame += 8)
+    {
+        const __m256 a = _mm256_loadu_ps(interleaved + frame * 2);
+        const __m256 b = _mm256_loadu_ps(interleaved + frame * 2 + 8);
+
+        _mm256_storeu_ps(destination + frame, _mm256_mul_ps(pairSums(a, b), half));
+    }
+
+    Scalar::downmix(interleaved + frame * 2, frames - frame, channels, destination + frame);
+}
+
+KOMPLEX_AVX2 static float sumOfSquares(const float *samples, int count)
+{
+    __m256 sum = _mm256_setzero_ps();
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256 value = _mm256_loadu_ps(samples + i);
+        sum = _mm256_fmadd_ps(value, value, sum);
+    }
+
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    return _mm_cvtss_f32(half) + SSE2::sumOfSquares(samples + i, count - i);
+}
+
+KOMPLEX_AVX2 static void applyWindow(const float *samples, const float *window, float *destination, int count)
+{
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), _mm256_loadu_ps(window + i)));
+
+    Scalar::applyWindow(samples + i, window + i, destination + i, count - i);
+}
+
+KOMPLEX_AVX2 static void magnitude(const float *spectrum, float *destination, int bins, float scale)
+{
+    const __m256 factor = _mm256_set1_ps(scale);
+    int i = 0;
+
+    for(; i + 8 <= bins; i += 8)
+    {
+        const __m256 a = _mm256_loadu_ps(spectrum + i * 2);
+        const __m256 b = _mm256_loadu_ps(spectrum + i * 2 + 8);
+        const __m256 sum = pairSums(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+
+        _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_sqrt_ps(sum), factor));
+    }
+
+    Scalar::magnitude(spectrum + i * 2, destination + i, bins - i, scale);
+}
+
+KOMPLEX_AVX2 static void smooth(const float *magnitude, float *state, int count, float timeConstant)
+{
+    const __m256 previous = _mm256_set1_ps(timeConstant);
+    const __m256 current = _mm256_set1_ps(1.0f - timeConstant);
+    const __m256 absolute = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256 value = _mm256_fmadd_ps(_mm256_loadu_ps(state + i), previous, _mm256_mul_ps(_mm256_loadu_ps(magnitude + i), current));
+
+        _mm256_storeu_ps(state + i, _mm256_and_ps(value, _mm256_cmp_ps(_mm256_and_ps(value, absolute), infinity, _CMP_LT_OQ)));
+    }
+
+    SSE2::smooth(magnitude + i, state + i, count - i, timeConstant);
+}
+
+KOMPLEX_AVX2 static void peakHold(const float *values, float *peaks, int count, float decay)
+{
+    const __m256 factor = _mm256_set1_ps(decay);
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(peaks + i, _mm256_max_ps(_mm256_loadu_ps(values + i), _mm256_mul_ps(_mm256_loadu_ps(peaks + i), factor)));
+
+    SSE2::peakHold(values + i, peaks + i, count - i, decay);
+}
+
+KOMPLEX_AVX2 static void decibelBytes(const float *magnitude, uchar *destination, int count, float minDb)
+{
+    const __m256 floor = _mm256_set1_ps(minDb);
+    const __m256 scale = _mm256_set1_ps(255.0f / -minDb);
+    int i = 0;
+
+    for(; i + 32 <= count; i += 32)
+    {
+        storeBytes(destination + i,
+                   decibelInts(_mm256_loadu_ps(magnitude + i), floor, scale),
+                   decibelInts(_mm256_loadu_ps(magnitude + i + 8), floor, scale),
+                   decibelInts(_mm256_loadu_ps(magnitude + i + 16), floor, scale),
+                   decibelInts(_mm256_loadu_ps(magnitude + i + 24), floor, scale));
+    }
+
+    SSE2::decibelBytes(magnitude + i, destination + i, count - i, minDb);
+}
+
+KOMPLEX_AVX2 static void waveBytes(const float *samples, uchar *destination, int count)
+{
+    int i = 0;
+
+    for(; i + 32 <= count; i += 32)
+    {
+        storeBytes(destination + i,
+                   waveInts(_mm256_loadu_ps(samples + i)),
+                   waveInts(_mm256_loadu_ps(samples + i + 8)),
+                   waveInts(_mm256_loadu_ps(samples + i + 16)),
+                   waveInts(_mm256_loadu_ps(samples + i + 24)));
+    }
+
+    SSE2::waveBytes(samples + i, destination + i, count - i);
+}
+}
+#endif // KOMPLEX_KERNELS_X86
+
+#if defined(KOMPLEX_KERNELS_NEON)
+/*
+ * NEON
+ */
+namespace NEON
+{
+static inline float32x4_t log2(float32x4_t x)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const uint32x4_t bits = vreinterpretq_u32_f32(x);
+
+    const float32x4_t exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+    const float32x4_t mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+
+    const float32x4_t t = vdivq_f32(vsubq_f32(mantissa, one), vaddq_f32(mantissa, one));
+    const float32x4_t t2 = vmulq_f32(t, t);
+
+    float32x4_t poly = vdupq_n_f32(0.41219858f);
+    poly = vfmaq_f32(vdupq_n_f32(0.57707801f), poly, t2);
+    poly = vfmaq_f32(vdupq_n_f32(0.96179669f), poly, t2);
+    poly = vfmaq_f32(vdupq_n_f32(2.88539008f), poly, t2);
+
+    return vfmaq_f32(exponent, poly, t);
+}
+
+static inline int32x4_t decibelInts(float32x4_t magnitude, float32x4_t minDb, float32x4_t scale)
+{
+    const float32x4_t db = vmulq_n_f32(log2(vmaxq_f32(magnitude, vdupq_n_f32(MagnitudeFloor))), DecibelsPerOctave);
+    const float32x4_t clamped = vminq_f32(vmaxq_f32(db, minDb), vdupq_n_f32(0.0f));
+
+    return vcvtq_s32_f32(vmulq_f32(vsubq_f32(clamped, minDb), scale));
+}
+
+static inline int32x4_t waveInts(float32x4_t sample)
+{
+    const float32x4_t clamped = vminq_f32(vmaxq_f32(sample, vdupq_n_f32(-WaveLimit)), vdupq_n_f32(WaveLimit));
+    const int32x4_t value = vcvtq_s32_f32(vfmaq_n_f32(vdupq_n_f32(1.0f), clamped, 128.0f));
+
+    return vaddq_s32(value, value);
+}
+
+static inline void storeBytes(uchar *destination, int32x4_t a, int32x4_t b, int32x4_t c, int32x4_t d)
+{
+    const int16x8_t low = vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+    const int16x8_t high = vcombine_s16(vqmovn_s32(c), vqmovn_s32(d));
+
+    vst1q_u8(destination, vcombine_u8(vqmovun_s16(low), vqmovun_s16(high)));
+}
+
+static void downmix(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    if(channels != 2)
+    {
+        if(channels == 1)
+            std::memcpy(destination, interleaved, frames * sizeof(float));
+        else
+            Scalar::downmix(interleaved, frames, channels, destination);
+
+        return;
+    }
+
+    quint32 frame = 0;
+
+    for(; frame + 4 <= frames; frame += 4)
+    {
+        const float32x4x2_t stereo = vld2q_f32(interleaved + frame * 2);
+        vst1q_f32(destination + frame, vmulq_n_f32(vaddq_f32(stereo.val[0], stereo.val[1]), 0.5f));
+    }
+
+    Scalar::downmix(interleaved + frame * 2, frames - frame, channels, destination + frame);
+}
+
+static void deinterleave(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    if(channels != 2)
+    {
+        if(channels == 1)
+            std::memcpy(destination, interleaved, frames * sizeof(float));
+        else
+            Scalar::deinterleave(interleaved, frames, channels, destination);
+
+        return;
+    }
+
+    float *left = destination;
+    float *right = destination + frames;
+    quint32 frame = 0;
+
+    for(; frame + 4 <= frames; frame += 4)
+    {
+        const float32x4x2_t stereo = vld2q_f32(interleaved + frame * 2);
+
+        vst1q_f32(left + frame, stereo.val[0]);
+        vst1q_f32(right + frame, stereo.val[1]);
+    }
+
+    for(; frame < frames; ++frame)
+    {
+        left[frame] = interleaved[frame * 2];
+        right[frame] = interleaved[frame * 2 + 1];
+    }
+}
+
+static float sumOfSquares(const float *samples, int count)
+{
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+    {
+        const float32x4_t value = vld1q_f32(samples + i);
+        sum = vfmaq_f32(sum, value, value);
+    }
+
+    return vaddvq_f32(sum) + Scalar::sumOfSquares(samples + i, count - i);
+}
+
+static void applyWindow(const float *samples, const float *window, float *destination, int count)
+{
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+        vst1q_f32(destination + i, vmulq_f32(vld1q_f32(samples + i), vld1q_f32(window + i)));
+
+    Scalar::applyWindow(samples + i, window + i, destination + i, count - i);
+}
+
+static void magnitude(const float *spectrum, float *destination, int bins, float scale)
+{
+    int i = 0;
+
+    for(; i + 4 <= bins; i += 4)
+    {
+        const float32x4x2_t complex = vld2q_f32(spectrum + i * 2);
+        const float32x4_t sum = vfmaq_f32(vmulq_f32(complex.val[0], complex.val[0]), complex.val[1], complex.val[1]);
+
+        vst1q_f32(destination + i, vmulq_n_f32(vsqrtq_f32(sum), scale));
+    }
+
+    Scalar::magnitude(spectrum + i * 2, destination + i, bins - i, scale);
+}
+
+static void smooth(const float *magnitude, float *state, int count, float timeConstant)
+{
+    const float32x4_t infinity = vdupq_n_f32(std::numeric_limits<float>::infinity());
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+    {
+        const float32x4_t value = vfmaq_n_f32(vmulq_n_f32(vld1q_f32(magnitude + i), 1.0f - timeConstant), vld1q_f32(state + i), timeConstant);
+        const uint32x4_t finite = vcltq_f32(vabsq_f32(value), infinity);
+
+        vst1q_f32(state + i, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(value), finite)));
+    }
+
+    Scalar::smooth(magnitude + i, state + i, count - i, timeConstant);
+}
+
+static void peakHold(const float *values, float *peaks, int count, float decay)
+{
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+        vst1q_f32(peaks + i, vmaxq_f32(vld1q_f32(values + i), vmulq_n_f32(vld1q_f32(peaks + i), decay)));
+
+    Scalar::peakHold(values + i, peaks + i, count - i, decay);
+}
+
+static void decibelBytes(const float *magnitude, uchar *destination, int count, float minDb)
+{
+    const float32x4_t floor = vdupq_n_f32(minDb);
+    const float32x4_t scale = vdupq_n_f32(255.0f / -minDb);
+    int i = 0;
+
+    for(; i + 16 <= count; i += 16)
+    {
+        storeBytes(destination + i,
+                   decibelInts(vld1q_f32(magnitude + i), floor, scale),
+                   decibelInts(vld1q_f32(magnitude + i + 4), floor, scale),
+                   decibelInts(vld1q_f32(magnitude + i + 8), floor, scale),
+                   decibelInts(vld1q_f32(magnitude + i + 12), floor, scale));
+    }
+
+    Scalar::decibelBytes(magnitude + i, destination + i, count - i, minDb);
+}
+
+static void waveBytes(const float *samples, uchar *destination, int count)
+{
+    int i = 0;
+
+    for(; i + 16 <= count; i += 16)
+    {
+        storeBytes(destination + i,
+                   waveInts(vld1q_f32(samples + i)),
+                   waveInts(vld1q_f32(samples + i + 4)),
+                   waveInts(vld1q_f32(samples + i + 8)),
+                   waveInts(vld1q_f32(samples + i + 12)));
+    }
+
+    Scalar::waveBytes(samples + i, destination + i, count - i);
+}
+}
+#endif // KOMPLEX_KERNELS_NEON
+
+/*
+ * Runtime dispatch
+ */
+std::vector<KernelTable> supportedKernels()
+{
+    std::vector<KernelTable> tables;
+
+#if defined(KOMPLEX_KERNELS_X86)
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        tables.push_back({AVX2::downmix, SSE2::deinterleave, AVX2::sumOfSquares, AVX2::applyWindow, AVX2::magnitude, AVX2::smooth, AVX2::peakHold, AVX2::decibelBytes, AVX2::waveBytes, "avx2"});
+
+    if(__builtin_cpu_supports("sse2"))
+        tables.push_back({SSE2::downmix, SSE2::deinterleave, SSE2::sumOfSquares, SSE2::applyWindow, SSE2::magnitude, SSE2::smooth, SSE2::peakHold, SSE2::decibelBytes, SSE2::waveBytes, "sse2"});
+#elif defined(KOMPLEX_KERNELS_NEON)
+    tables.push_back({NEON::downmix, NEON::deinterleave, NEON::sumOfSquares, NEON::applyWindow, NEON::magnitude, NEON::smooth, NEON::peakHold, NEON::decibelBytes, NEON::waveBytes, "neon"});
+#endif
+
+    tables.push_back({Scalar::downmix, Scalar::deinterleave, Scalar::sumOfSquares, Scalar::applyWindow, Scalar::magnitude, Scalar::smooth, Scalar::peakHold, Scalar::decibelBytes, Scalar::waveBytes, "scalar"});
+
+    return tables;
+}
+
+static const KernelTable &kernels()
+{
+    static const KernelTable table = supportedKernels().front();
+    return table;
+}
+
+void downmix(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    kernels().downmix(interleaved, frames, channels, destination);
+}
+
+void deinterleave(const float *interleaved, quint32 frames, quint32 channels, float *destination)
+{
+    kernels().deinterleave(interleaved, frames, channels, destination);
+}
+
+float sumOfSquares(const float *samples, int count)
+{
+    return kernels().sumOfSquares(samples, count);
+}
+
+void applyWindow(const float *samples, const float *window, float *destination, int count)
+{
+    kernels().applyWindow(samples, window, destination, count);
+}
+
+void magnitude(const float *spectrum, float *destination, int bins, float scale)
+{
+    kernels().magnitude(spectrum, destination, bins, scale);
+}
+
+void smooth(const float *magnitude, float *state, int count, float timeConstant)
+{
+    kernels().smooth(magnitude, state, count, timeConstant);
+}
+
+void peakHold(const float *values, float *peaks, int count, float decay)
+{
+    kernels().peakHold(values, peaks, count, decay);
+}
+
+void decibelBytes(const float *magnitude, uchar *destination, int count, float minDb)
+{
+    kernels().decibelBytes(magnitude, destination, count, minDb);
+}
+
+void waveBytes(const float *samples, uchar *destination, int count)
+{
+    kernels().waveBytes(samples, destination, count);
+}
+
+const char *implementation()
+{
+    return kernels().name;
+}
+}
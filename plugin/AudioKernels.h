@@ -0,0 +1,158 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  AudioKernels.h
+ *
+ *  Vectorized float32 loops used by the audio analysis. Every kernel has an
+ *  SSE2, AVX2 and NEON version where the platform allows it, and the fastest
+ *  one supported by the running CPU is picked on first use.
+ *
+ *  The Scalar namespace holds the reference implementation the vector
+ *  versions are expected to match (within one 8-bit step for the byte
+ *  conversions).
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef AUDIOKERNELS_H
+#define AUDIOKERNELS_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+namespace AudioKernels
+{
+/**!
+ * @brief downmix
+ * Averages every channel of an interleaved buffer into a mono buffer.
+ *
+ * @param interleaved Source buffer of frames * channels samples
+ * @param frames Number of frames to convert
+ * @param channels Number of channels per frame
+ * @param destination Buffer of at least frames samples
+ */
+void downmix(const float *interleaved, quint32 frames, quint32 channels, float *destination);
+
+/**!
+ * @brief deinterleave
+ * Splits an interleaved buffer into one contiguous block per channel.
+ *
+ * @param interleaved Source buffer of frames * channels samples
+ * @param frames Number of frames to convert
+ * @param channels Number of channels per frame
+ * @param destination Buffer of frames * channels samples, channel c starts at c * frames
+ */
+void deinterleave(const float *interleaved, quint32 frames, quint32 channels, float *destination);
+
+/**!
+ * @brief sumOfSquares
+ * Sum of samples[i]^2, used for the RMS level of a capture buffer.
+ */
+float sumOfSquares(const float *samples, int count);
+
+/**!
+ * @brief applyWindow
+ * destination[i] = samples[i] * window[i]
+ */
+void applyWindow(const float *samples, const float *window, float *destination, int count);
+
+/**!
+ * @brief magnitude
+ * Converts interleaved complex bins (re, im) into scaled magnitudes.
+ *
+ * @param spectrum Interleaved complex output of the FFT
+ * @param destination Buffer of at least bins floats
+ * @param bins Number of complex bins
+ * @param scale Factor applied to every magnitude, usually 1 / fftSize
+ */
+void magnitude(const float *spectrum, float *destination, int bins, float scale);
+
+/**!
+ * @brief smooth
+ * Web Audio smoothing over time, state[i] = timeConstant * state[i] +
+ * (1 - timeConstant) * magnitude[i]. Values that turn out NaN or infinite
+ * reset to 0 as the specification asks.
+ *
+ * @param magnitude Magnitudes of the current frame
+ * @param state Smoothed magnitudes of the previous frame, updated in place
+ * @param count Number of values
+ * @param timeConstant Weight of the previous frame, between 0 and 1
+ */
+void smooth(const float *magnitude, float *state, int count, float timeConstant);
+
+/**!
+ * @brief peakHold
+ * peaks[i] = max(values[i], peaks[i] * decay)
+ */
+void peakHold(const float *values, float *peaks, int count, float decay);
+
+/**!
+ * @brief decibelBytes
+ * Converts magnitudes to dB, clamps them to [minDb, 0] and maps that range
+ * onto 0-255.
+ */
+void decibelBytes(const float *magnitude, uchar *destination, int count, float minDb);
+
+/**!
+ * @brief waveBytes
+ * Converts raw samples into the 8-bit waveform row of the audio texture.
+ */
+void waveBytes(const float *samples, uchar *destination, int count);
+
+/**!
+ * @brief implementation
+ * Name of the instruction set the kernels were dispatched to.
+ */
+const char *implementation();
+
+// one implementation of every kernel
+struct KernelTable
+{
+    void (*downmix)(const float *, quint32, quint32, float *);
+    void (*deinterleave)(const float *, quint32, quint32, float *);
+    float (*sumOfSquares)(const float *, int);
+    void (*applyWindow)(const float *, const float *, float *, int);
+    void (*magnitude)(const float *, float *, int, float);
+    void (*smooth)(const float *, float *, int, float);
+    void (*peakHold)(const float *, float *, int, float);
+    void (*decibelBytes)(const float *, uchar *, int, float);
+    void (*waveBytes)(const float *, uchar *, int);
+    const char *name;
+};
+
+/**!
+ * @brief supportedKernels
+ * Every implementation the running CPU supports, fastest first and Scalar
+ * last. The dispatch uses the first one, tests compare the others against
+ * Scalar.
+ */
+std::vector<KernelTable> supportedKernels();
+
+namespace Scalar
+{
+void downmix(const float *interleaved, quint32 frames, quint32 channels, float *destination);
+void deinterleave(const float *interleaved, quint32 frames, quint32 channels, float *destination);
+float sumOfSquares(const float *samples, int count);
+void applyWindow(const float *samples, const float *window, float *destination, int count);
+void magnitude(const float *spectrum, float *destination, int bins, float scale);
+void smooth(const float *magnitude, float *state, int count, float timeConstant);
+void peakHold(const float *values, float *peaks, int count, float decay);
+void decibelBytes(const float *magnitude, uchar *destination, int count, float minDb);
+void waveBytes(const float *samples, uchar *destination, int count);
+}
+}
+
+#endif // AUDIOKERNELS_H
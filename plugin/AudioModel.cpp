@@ -10,36 +10,34 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <bit>
+#include <chrono>
+#include <cstring>
 #include <fftw3.h>
 
+#include <QCoreApplication>
+
 #include "AudioModel.h"
+#include "AudioKernels.h"
+#include "KomplexAudioLogging.h"
 
 AudioModel::AudioModel(QObject *parent) : QObject(parent)
 {
-    //init a blank 512x2 texture for the audio provider
-    m_frame = QPixmap(512, 2);
-    m_frame.fill(QColor());
-
-    m_impl_data = { nullptr, nullptr, {0, 0, {}}, 1, {}, {}, 0.0};
-    m_impl_data.samples.reserve(4096);
-    m_impl_data.smoothed.reserve(2048);
-
-    //fill the smoothed data buffer with 0s
-    for(int i = 0; i < 2048; ++i)
-        m_impl_data.smoothed.insert(i, 0);
-
     m_thread = new QThread(parent);
 
     moveToThread(m_thread);
     connect(m_thread, &QThread::started, this, &AudioModel::startCaptureAsync);
 
-    const struct spa_pod *params[1];
-    uint8_t buffer[1024];
     struct pw_properties *props;
-    struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 
     pw_init(nullptr, nullptr);
 
+    // resolve the kernel dispatch here so the realtime thread never does it.
+    // called outside the log statement, which skips its arguments while the
+    // category is disabled
+    const char *kernels = AudioKernels::implementation();
+    qCDebug(KOMPLEX_AUDIO, "Audio kernels: %s", kernels);
+
     /* make a main loop. If you already have another main loop, you can add
          * the fd of this pipewire mainloop to it. */
     m_impl_data.loop = pw_main_loop_new(NULL);
@@ -66,6 +64,10 @@ AudioModel::AudioModel(QObject *parent) : QObject(parent)
     /* uncomment if you want to capture from the sink monitor ports */
     pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
 
+    /* capture a specific node instead of the default sink */
+    if(!m_targetNode.isEmpty())
+        pw_properties_set(props, PW_KEY_TARGET_OBJECT, m_targetNode.constData());
+
     m_impl_data.stream = pw_stream_new_simple(
         pw_main_loop_get_loop(m_impl_data.loop),
         "audio-capture",
@@ -73,27 +75,7 @@ AudioModel::AudioModel(QObject *parent) : QObject(parent)
         &stream_events,
         &m_impl_data);
 
-    struct spa_audio_info_raw info = SPA_AUDIO_INFO_RAW_INIT(
-                                        .format = SPA_AUDIO_FORMAT_F32,
-                                        .rate = 44100,
-                                        .channels = 2
-                                    );
-
-    /* Make one parameter with the supported formats. The SPA_PARAM_EnumFormat
-         * id means that this is a format enumeration (of 1 value).
-         * We leave the channels and rate empty to accept the native graph
-         * rate and channels. */
-    params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info);
-
-    /* Now connect this stream. We ask that our process function is
-         * called in a realtime thread. */
-    pw_stream_connect(m_impl_data.stream,
-                      PW_DIRECTION_INPUT,
-                      PW_ID_ANY,
-                      static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT |
-                          PW_STREAM_FLAG_MAP_BUFFERS |
-                          PW_STREAM_FLAG_RT_PROCESS),
-                      params, 1);
+    connectStream(&m_impl_data);
 
     if(!m_instance)
         m_instance = this;
@@ -119,6 +101,15 @@ AudioModel::~AudioModel()
         m_thread->deleteLater();
     }
 
+    if(m_analysisThread)
+    {
+        m_analysisThread->wait();
+        delete m_analysisThread;
+        m_analysisThread = nullptr;
+    }
+
+    m_sharedFrame.reset();
+
     pw_deinit();
 }
 
@@ -129,10 +120,28 @@ void AudioModel::startCapture()
         
     ++m_clients;
 
-    if(m_thread->isRunning())
+    // a new client while the others are paused has to wake the stream
+    if(m_suspendedClients > 0)
+        updateStreamActive();
+
+    if(m_running.load(std::memory_order_acquire))
         return;
 
-    m_thread->start(QThread::NormalPriority);
+    m_running.store(true, std::memory_order_release);
+
+    // another process may already be analysing the same audio, in which case
+    // the worker copies its frames and the PipeWire loop is never started
+    if(m_sharedAnalysis && !m_sharedFrame)
+        m_sharedFrame = AudioSharedFrame::open(sizeof(m_frameData));
+
+    // a thread made by QThread::create runs only once, every capture gets
+    // its own. stopCapture() has waited for the previous one
+    m_analysisThread = QThread::create(&AudioModel::analysisLoop);
+    m_analysisThread->setObjectName(QStringLiteral("komplex-audio-analysis"));
+    m_analysisThread->start(m_analysisPriority);
+
+    if(!m_sharedFrame || m_sharedFrame->role() == AudioSharedFrame::Producer)
+        m_thread->start(QThread::NormalPriority);
 }
 
 void AudioModel::stopCapture()
@@ -143,8 +152,324 @@ void AudioModel::stopCapture()
     if(m_thread->isRunning())
         m_thread->quit();
     
-    m_running = false;
+    m_running.store(false, std::memory_order_release);
+    m_analysisWake.release();
     pw_main_loop_quit(m_impl_data.loop);
+
+    // the worker notices within one wait timeout. it is gone before a new
+    // client can start capturing again
+    if(m_analysisThread)
+    {
+        m_analysisThread->wait();
+        delete m_analysisThread;
+        m_analysisThread = nullptr;
+    }
+
+    // samples the realtime thread had no room for while the worker lagged
+    if(const quint64 overruns = m_impl_data.samples.takeOverruns())
+        qCDebug(KOMPLEX_AUDIO, "Dropped %llu captured samples, the analysis fell behind", static_cast<unsigned long long>(overruns));
+}
+
+void AudioModel::connectStream(impl *data)
+{
+    const struct spa_pod *params[1];
+    uint8_t buffer[1024];
+    struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+    /* Stereo is enough for every mode but AllChannels, which leaves the
+     * channel count open to get the node's own layout. The rate is left
+     * open so PipeWire does not resample, the analysis adapts to it. */
+    struct spa_audio_info_raw info = SPA_AUDIO_INFO_RAW_INIT(
+                                        .format = SPA_AUDIO_FORMAT_F32,
+                                        .channels = data->channelMode.load(std::memory_order_relaxed) == AllChannels ? 0u : 2u
+                                    );
+
+    /* Make one parameter with the supported formats. The SPA_PARAM_EnumFormat
+         * id means that this is a format enumeration (of 1 value).
+         * We leave the channels and rate empty to accept the native graph
+         * rate and channels. */
+    params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info);
+
+    /* Now connect this stream. We ask that our process function is
+         * called in a realtime thread. */
+    pw_stream_connect(data->stream,
+                      PW_DIRECTION_INPUT,
+                      PW_ID_ANY,
+                      static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT |
+                          PW_STREAM_FLAG_MAP_BUFFERS |
+                          PW_STREAM_FLAG_RT_PROCESS),
+                      params, 1);
+}
+
+void AudioModel::reconnectStream()
+{
+    if(!m_impl_data.loop)
+        return;
+
+    // the target is copied along with the invocation, so it may change again right away
+    pw_loop_invoke(pw_main_loop_get_loop(m_impl_data.loop), do_reconnect, SPA_ID_INVALID, m_targetNode.constData(), m_targetNode.size() + 1, false, &m_impl_data);
+
+    // reconnecting activates the stream again
+    if(m_suspendedClients > 0)
+        updateStreamActive();
+}
+
+int AudioModel::do_reconnect(struct spa_loop *loop, bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+    Q_UNUSED(loop)
+    Q_UNUSED(async)
+    Q_UNUSED(seq)
+
+    struct impl *impl = reinterpret_cast<struct impl*>(user_data);
+
+    if(!impl->stream)
+        return 0;
+
+    pw_stream_disconnect(impl->stream);
+
+    // a NULL value removes the key, which goes back to the default sink
+    const char *target = size > 1 ? static_cast<const char*>(data) : nullptr;
+    const struct spa_dict_item items[] = { SPA_DICT_ITEM_INIT(PW_KEY_TARGET_OBJECT, target) };
+    const struct spa_dict dict = SPA_DICT_INIT_ARRAY(items);
+
+    pw_stream_update_properties(impl->stream, &dict);
+    connectStream(impl);
+
+    return 0;
+}
+
+void AudioModel::suspendCapture()
+{
+    ++m_suspendedClients;
+    updateStreamActive();
+}
+
+void AudioModel::resumeCapture()
+{
+    if(m_suspendedClients > 0)
+        --m_suspendedClients;
+
+    updateStreamActive();
+}
+
+void AudioModel::updateStreamActive()
+{
+    if(!m_impl_data.loop)
+        return;
+
+    // the stream belongs to the PipeWire loop thread, so the change is
+    // invoked there instead of touching the stream from here
+    const bool active = m_suspendedClients < m_clients;
+    pw_loop_invoke(pw_main_loop_get_loop(m_impl_data.loop), do_set_active, SPA_ID_INVALID, &active, sizeof(active), false, &m_impl_data);
+}
+
+int AudioModel::do_set_active(struct spa_loop *loop, bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+    Q_UNUSED(loop)
+    Q_UNUSED(async)
+    Q_UNUSED(seq)
+    Q_UNUSED(size)
+
+    struct impl *impl = reinterpret_cast<struct impl*>(user_data);
+
+    if(impl->stream)
+        pw_stream_set_active(impl->stream, *static_cast<const bool*>(data));
+
+    return 0;
+}
+
+int AudioModel::hopSize() const
+{
+    return static_cast<int>(m_impl_data.hopSize.load(std::memory_order_relaxed));
+}
+
+void AudioModel::setHopSize(int hopSize)
+{
+    hopSize = std::clamp(hopSize, 64, MaximumFftSize);
+
+    if(m_impl_data.hopSize.exchange(hopSize, std::memory_order_relaxed) != static_cast<quint64>(hopSize))
+        Q_EMIT hopSizeChanged();
+}
+
+int AudioModel::analysisPriority() const
+{
+    return m_analysisPriority;
+}
+
+void AudioModel::setAnalysisPriority(int value)
+{
+    const QThread::Priority priority = static_cast<QThread::Priority>(std::clamp<int>(value, QThread::IdlePriority, QThread::TimeCriticalPriority));
+
+    if(m_analysisPriority == priority)
+        return;
+
+    m_analysisPriority = priority;
+
+    if(m_analysisThread && m_analysisThread->isRunning())
+        m_analysisThread->setPriority(priority);
+
+    Q_EMIT analysisPriorityChanged();
+}
+
+int AudioModel::fftSize() const
+{
+    return m_impl_data.fftSize.load(std::memory_order_relaxed);
+}
+
+void AudioModel::setFftSize(int size)
+{
+    size = static_cast<int>(std::bit_ceil(static_cast<quint32>(std::clamp(size, MinimumFftSize, MaximumFftSize))));
+
+    if(m_impl_data.fftSize.exchange(size, std::memory_order_relaxed) == size)
+        return;
+
+    m_impl_data.settingsGeneration.fetch_add(1, std::memory_order_release);
+    Q_EMIT fftSizeChanged();
+}
+
+int AudioModel::textureWidth() const
+{
+    return m_impl_data.textureWidth.load(std::memory_order_relaxed);
+}
+
+void AudioModel::setTextureWidth(int width)
+{
+    width = std::clamp(width, MinimumTextureWidth, MaximumTextureWidth);
+
+    if(m_impl_data.textureWidth.exchange(width, std::memory_order_relaxed) == width)
+        return;
+
+    m_impl_data.settingsGeneration.fetch_add(1, std::memory_order_release);
+    Q_EMIT textureWidthChanged();
+}
+
+AudioModel::SpectrumMapping AudioModel::spectrumMapping() const
+{
+    return static_cast<SpectrumMapping>(m_impl_data.spectrumMapping.load(std::memory_order_relaxed));
+}
+
+void AudioModel::setSpectrumMapping(SpectrumMapping mapping)
+{
+    if(m_impl_data.spectrumMapping.exchange(mapping, std::memory_order_relaxed) == mapping)
+        return;
+
+    m_impl_data.settingsGeneration.fetch_add(1, std::memory_order_release);
+    Q_EMIT spectrumMappingChanged();
+}
+
+qreal AudioModel::smoothingTimeConstant() const
+{
+    return m_impl_data.smoothingTimeConstant.load(std::memory_order_relaxed);
+}
+
+void AudioModel::setSmoothingTimeConstant(qreal timeConstant)
+{
+    const float value = static_cast<float>(std::clamp<qreal>(timeConstant, 0.0, 1.0));
+
+    if(m_impl_data.smoothingTimeConstant.exchange(value, std::memory_order_relaxed) != value)
+        Q_EMIT smoothingTimeConstantChanged();
+}
+
+qreal AudioModel::peakDecay() const
+{
+    return m_impl_data.peakDecay.load(std::memory_order_relaxed);
+}
+
+void AudioModel::setPeakDecay(qreal decibelsPerSecond)
+{
+    const float value = static_cast<float>(std::max<qreal>(decibelsPerSecond, 0.0));
+
+    if(m_impl_data.peakDecay.exchange(value, std::memory_order_relaxed) != value)
+        Q_EMIT peakDecayChanged();
+}
+
+qreal AudioModel::silenceThreshold() const
+{
+    return 10.0 * std::log10(m_impl_data.silenceLevel.load(std::memory_order_relaxed));
+}
+
+void AudioModel::setSilenceThreshold(qreal decibels)
+{
+    // compared against the mean square of each buffer, which saves a sqrt per buffer
+    const float level = static_cast<float>(std::pow(10.0, std::clamp<qreal>(decibels, -120.0, 0.0) / 10.0));
+
+    if(m_impl_data.silenceLevel.exchange(level, std::memory_order_relaxed) != level)
+        Q_EMIT silenceThresholdChanged();
+}
+
+qreal AudioModel::idleTimeout() const
+{
+    return m_impl_data.idleTimeout.load(std::memory_order_relaxed);
+}
+
+void AudioModel::setIdleTimeout(qreal seconds)
+{
+    const float value = static_cast<float>(std::max<qreal>(seconds, 0.0));
+
+    if(m_impl_data.idleTimeout.exchange(value, std::memory_order_relaxed) != value)
+        Q_EMIT idleTimeoutChanged();
+}
+
+bool AudioModel::isIdle() const
+{
+    return m_impl_data.idle.load(std::memory_order_relaxed);
+}
+
+AudioModel::ChannelMode AudioModel::channelMode() const
+{
+    return static_cast<ChannelMode>(m_impl_data.channelMode.load(std::memory_order_relaxed));
+}
+
+void AudioModel::setChannelMode(ChannelMode mode)
+{
+    const int previous = m_impl_data.channelMode.exchange(mode, std::memory_order_relaxed);
+
+    if(previous == mode)
+        return;
+
+    // the realtime thread picks the new layout up with the next buffer, only
+    // the native channel layout needs a different stream format
+    if((previous == AllChannels) != (mode == AllChannels))
+        reconnectStream();
+
+    Q_EMIT channelModeChanged();
+}
+
+QString AudioModel::targetNode() const
+{
+    return QString::fromUtf8(m_targetNode);
+}
+
+void AudioModel::setTargetNode(const QString &target)
+{
+    const QByteArray node = target.trimmed().toUtf8();
+
+    if(m_targetNode == node)
+        return;
+
+    m_targetNode = node;
+    reconnectStream();
+
+    Q_EMIT targetNodeChanged();
+}
+
+bool AudioModel::sharedAnalysis() const
+{
+    return m_sharedAnalysis;
+}
+
+void AudioModel::setSharedAnalysis(bool shared)
+{
+    if(m_sharedAnalysis == shared)
+        return;
+
+    shareAnalysis(shared);
+    Q_EMIT sharedAnalysisChanged();
+}
+
+void AudioModel::shareAnalysis(bool shared)
+{
+    m_sharedAnalysis = shared;
 }
 
 void AudioModel::startCaptureAsync()
@@ -152,17 +477,106 @@ void AudioModel::startCaptureAsync()
     pw_main_loop_run(m_impl_data.loop);
 }
 
-QPixmap AudioModel::frame()
+QImage AudioModel::frame()
 {
-    if(!m_instance)
+    QImage frame;
+    readFrame(frame);
+
+    return frame;
+}
+
+bool AudioModel::readFrame(QImage &destination, FrameInfo *info)
+{
+    for(;;)
     {
-        QPixmap frame = QPixmap(512, 2);
-        frame.fill(QColor());
-        
-        return frame;
+        const quint64 lock = m_frameLock.load(std::memory_order_acquire);
+
+        // the worker is in the middle of a copy, it only takes a moment
+        if(lock & 1)
+        {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        // the size is part of the frame, it changes with textureWidth and the
+        // number of analysed channels
+        const int width = m_frameWidth.load(std::memory_order_relaxed);
+        const int height = m_frameHeight.load(std::memory_order_relaxed);
+
+        if(destination.size() != QSize(width, height) || destination.format() != QImage::Format_Grayscale8)
+            destination = QImage(width, height, QImage::Format_Grayscale8);
+
+        for(int row = 0; row < height; ++row)
+            std::memcpy(destination.scanLine(row), m_frameData + row * width, width);
+
+        const qint64 captureTime = m_frameCaptureTime.load(std::memory_order_relaxed);
+        AudioFeatures::Values features;
+        std::memcpy(&features, &m_frameFeatures, sizeof(features));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(m_frameLock.load(std::memory_order_relaxed) != lock)
+            continue;
+
+        if(info)
+        {
+            info->sequence = lock / 2;
+            info->captureTime = captureTime;
+            info->features = features;
+        }
+
+        return lock != 0;
     }
-    
-    return m_instance->m_frame;
+}
+
+quint64 AudioModel::frameSequence()
+{
+    return m_frameLock.load(std::memory_order_acquire) / 2;
+}
+
+AudioFeatures::Values AudioModel::features()
+{
+    AudioFeatures::Values features;
+
+    for(;;)
+    {
+        const quint64 lock = m_frameLock.load(std::memory_order_acquire);
+
+        if(lock & 1)
+        {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        std::memcpy(&features, &m_frameFeatures, sizeof(features));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(m_frameLock.load(std::memory_order_relaxed) == lock)
+            return features;
+    }
+}
+
+void AudioModel::publishFrame(const uchar *data, QSize size, qint64 captureTime, const AudioFeatures::Values &features)
+{
+    const quint64 lock = m_frameLock.load(std::memory_order_relaxed);
+
+    m_frameLock.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(m_frameData, data, size.width() * size.height());
+    m_frameWidth.store(size.width(), std::memory_order_relaxed);
+    m_frameHeight.store(size.height(), std::memory_order_relaxed);
+    m_frameCaptureTime.store(captureTime, std::memory_order_relaxed);
+    std::memcpy(&m_frameFeatures, &features, sizeof(features));
+
+    m_frameLock.store(lock + 2, std::memory_order_release);
+
+    if(m_sharedFrame && m_sharedFrame->role() == AudioSharedFrame::Producer)
+        m_sharedFrame->publish(data, size, captureTime, features);
+
+    if(m_instance)
+        Q_EMIT m_instance->frameReady((lock + 2) / 2);
 }
 
 /* Be notified when the stream param changes. We're only looking at the
@@ -188,6 +602,16 @@ void AudioModel::on_stream_param_changed(void *_data, uint32_t id, const struct
     spa_format_audio_raw_parse(param, &data->format.info.raw);
 
     fprintf(stdout, "capturing rate:%d channels:%d\n", data->format.info.raw.rate, data->format.info.raw.channels);
+
+    /* The FFT plan and tables only depend on the format and the analysis
+     * settings. The analysis worker rebuilds its analyzer at the next frame
+     * boundary once it sees the settings generation change, so planning never
+     * happens here or on the realtime thread. */
+    const quint32 rate = data->format.info.raw.rate;
+    const quint32 channels = data->format.info.raw.channels;
+
+    if(data->rate.exchange(rate, std::memory_order_relaxed) != rate || data->channels.exchange(channels, std::memory_order_relaxed) != channels)
+        data->settingsGeneration.fetch_add(1, std::memory_order_release);
 }
 
 /* our data processing function is in general:
@@ -215,167 +639,288 @@ void AudioModel::on_process(void *userdata)
 
     buf = b->buffer;
     if ((samples = reinterpret_cast<float*>(buf->datas[0].data)) == NULL)
+    {
+        pw_stream_queue_buffer(data->stream, b);
         return;
+    }
 
     n_channels = data->format.info.raw.channels;
     n_samples = buf->datas[0].chunk->size / sizeof(float);
 
-    // convert channels to mono
-    for(uint32_t index = 0; index < n_samples; index += n_channels)
-    {
-        float average = 0;
+    const uint32_t n_frames = n_channels > 0 ? n_samples / n_channels : 0;
 
-        for(uint32_t channel = 0; channel < n_channels; channel++)
-            average += samples[index + channel];
+    // number of channels that go into the ring, mono is mixed down
+    quint32 channels = 1;
 
-        average /= n_channels;
+    switch(data->channelMode.load(std::memory_order_relaxed))
+    {
+    case Stereo:
+        channels = std::min<quint32>(n_channels, 2);
+        break;
+    case AllChannels:
+        channels = std::min<quint32>(n_channels, MaximumChannels);
+        break;
+    }
 
-        if(index > 0)
-            data->samples.push_back(average);
+    channels = std::max<quint32>(channels, 1);
+
+    // tell the worker where the new interleaving starts
+    if(channels != data->ringChannels)
+    {
+        data->ringChannels = channels;
+        data->ringLayout.store((data->samples.position() << impl::LayoutChannelBits) | channels, std::memory_order_release);
     }
 
-    /**
-     * To convert the captured samples to an audio texture we need to:
-     *
-     * Take 2048 samples of audio data as an array of floating point data
-     * 1. Calculate wave data
-     * 2. Multiply it with Blackman window
-     * 3. Convert samples into complex numbers (imaginary parts are all zeros)
-     * 4. Apply the Fourier transform with fftSize = 2048, as a result we get 1024 FFT bins
-     * 5. Convert complex result into real values using cabs() function
-     * 6. Divide each value by fftSize
-     * 7. Apply smoothing by using previously calculated spectrum values
-     * 8. Convert resulting values to dB: dB = 20 * log10(v)
-     * 9. Convert floating point dB spectrum into 8-bit values:
-     * 10. Write 8-bit values into texture
-     */
-
-    // 1
-    if(data->samples.length() >= 2048)
+    // high graph rates are brought near the reference rate before they
+    // reach the ring, a change of rate or layout starts the filter over
+    const int factor = AudioDecimator::factorFor(data->format.info.raw.rate);
+
+    if(factor != data->decimator.factor() || channels != data->decimator.channels())
+        data->decimator.reset(factor, channels);
+
+    quint64 total = 0;
+    float energy = 0.0f;
+
+    if(factor == 1)
     {
-        QVector<qreal> rawSamples = data->samples.mid(0, 2048);
-        data->samples.remove(0, 2048);
+        // convert the buffer straight into the ring buffer in one pass. only
+        // whole frames are written so the interleaving never slips, the analysis
+        // worker fell behind if they don't all fit and the rest is dropped
+        const quint64 writable = std::min<quint64>(n_frames, data->samples.space() / channels);
+        quint64 written = 0;
 
-        int N = 2048;
-        auto window = createBlackmanWindow(N);
-        std::vector<double> windowedSamples(N);
+        total = writable * channels;
 
-        QVector<int> waveData;
+        while(written < total)
+        {
+            quint64 space = 0;
+            float *destination = data->samples.writeSpan(space);
 
-        for (int i = 0; i < N; ++i) {
-            waveData.push_back(static_cast<int>(std::clamp(static_cast<int>(128 * rawSamples[i] + 1) * 2, 0, 255)));
-            windowedSamples[i] = rawSamples[i] * window[i];
-        }
+            const quint64 count = std::min(space, total - written);
 
-        // Step 2: Convert to complex
-        std::vector<std::complex<double>> complexSamples(N);
-        for (int i = 0; i < N; ++i) {
-            complexSamples[i] = std::complex<double>(windowedSamples[i], 0.0);
+            energy += AudioAnalyzer::convert(samples, n_channels, written, count, channels, destination);
+
+            data->samples.advance(count);
+            written += count;
         }
 
-        // Step 3: Apply FFTW3 transformation
-        fftw_plan plan = fftw_plan_dft_1d(N,
-                                          reinterpret_cast<fftw_complex*>(complexSamples.data()),
-                                          reinterpret_cast<fftw_complex*>(complexSamples.data()),
-                                          FFTW_FORWARD, FFTW_ESTIMATE);
-
-        fftw_execute(plan);
-        fftw_destroy_plan(plan);
-
-        // Step 4: Convert back to floats and divide by N
-        std::vector<float> magnitude(N);
-        for (int i = 0; i < N; ++i) {
-            double real = complexSamples[i].real();
-            double imag = complexSamples[i].imag();
-            magnitude[i] = static_cast<float>(std::sqrt(real * real + imag * imag) / N);
+        // the rest is dropped, but still converted into the scratch buffer
+        // so the idle detection sees all of it
+        for(quint64 first = total; first < quint64(n_frames) * channels;)
+        {
+            const quint64 count = std::min<quint64>(data->converted.size(), quint64(n_frames) * channels - first);
+
+            energy += AudioAnalyzer::convert(samples, n_channels, first, count, channels, data->converted.data());
+            first += count;
         }
 
-        // Step 5: Apply smoothing
-        auto smoothed = smoothData(magnitude, 3); // Using window size of 3
+        if(writable < n_frames)
+            data->samples.drop((n_frames - writable) * channels);
 
-        // Step 6: Convert to decibels
-        std::vector<float> dbValues(smoothed.size());
-        const float minDb = -100.0f; // Minimum dB value for clamping
-        const float reference = 1.0f; // Reference amplitude
+        total = quint64(n_frames) * channels;
+    }
+    else
+    {
+        // converted and decimated through the scratch buffers in pieces
+        for(quint64 frame = 0; frame < n_frames; frame += impl::ScratchFrames)
+        {
+            const quint64 count = std::min<quint64>(impl::ScratchFrames, n_frames - frame);
 
-        for (size_t i = 0; i < smoothed.size(); ++i) {
-            if (smoothed[i] > 0) {
-                dbValues[i] = 20.0f * std::log10(smoothed[i] / reference);
-            } else {
-                dbValues[i] = minDb;
-            }
+            energy += AudioAnalyzer::convert(samples + frame * n_channels, n_channels, 0, count * channels, channels, data->converted.data());
+            total += count * channels;
+
+            const quint64 decimated = data->decimator.process(data->converted.data(), count, data->decimated.data());
+            const quint64 writable = std::min<quint64>(decimated, data->samples.space() / channels);
+
+            data->samples.write(data->decimated.data(), writable * channels);
+
+            if(writable < decimated)
+                data->samples.drop((decimated - writable) * channels);
         }
+    }
+
+    data->samples.commit();
+    data->captureTime.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(),
+                            std::memory_order_relaxed);
+
+    pw_stream_queue_buffer(data->stream, b);
+
+    /* Idle detection over everything captured, whether it fit in the ring
+     * buffer or not. While idle the worker is not woken and only trims the
+     * ring down to the newest frame on its timeout, so there is always room
+     * for the samples and the first frame after a resume has its history. A
+     * single loud buffer ends it. */
+    const float idleTimeout = data->idleTimeout.load(std::memory_order_relaxed);
 
-        // Step 7: Clamp to 8-bit values for red channel
-        std::vector<uint8_t> redChannel(dbValues.size());
+    if(idleTimeout <= 0.0f || total == 0 || energy / total >= data->silenceLevel.load(std::memory_order_relaxed))
+    {
+        data->silentFrames = 0;
+        data->idle.store(false, std::memory_order_relaxed);
+    }
+    else if(!data->idle.load(std::memory_order_relaxed))
+    {
+        data->silentFrames += n_frames;
+
+        if(data->silentFrames >= static_cast<quint64>(idleTimeout * data->format.info.raw.rate))
+            data->idle.store(true, std::memory_order_relaxed);
+    }
 
-        for (size_t i = 0; i < dbValues.size(); ++i) {
-            // Clamp between -100dB and 0dB, then map to 0-255 range
-            float clamped = std::max(minDb, std::min(0.0f, dbValues[i]));
-            redChannel[i] = static_cast<uint8_t>((clamped + 100.0f) * 2.55f);
+    // the analysis worker does the heavy lifting, all we do here is wake it
+    if(!data->idle.load(std::memory_order_relaxed))
+        m_analysisWake.release();
+}
+
+void AudioModel::analysisLoop()
+{
+    struct impl *data = &m_impl_data;
+
+    while(m_running.load(std::memory_order_acquire))
+    {
+        if(m_sharedFrame && m_sharedFrame->role() == AudioSharedFrame::Consumer)
+        {
+            consumeSharedFrame();
+            continue;
         }
 
-        QPixmap audioTexture(512,2);
-        QPainter painter(&audioTexture);
-        painter.fillRect(QRect(0,0,512,2), QColor::fromRgb(0,0,0));
+        // the timeout only exists so a stop request or idle change is noticed
+        // while the worker is not being woken
+        const bool woken = m_analysisWake.tryAcquire(1, 100);
+
+        const bool idle = data->idle.load(std::memory_order_relaxed);
+
+        if(idle != data->reportedIdle)
+        {
+            data->reportedIdle = idle;
+
+            if(m_instance)
+                Q_EMIT m_instance->idleChanged();
+        }
 
-        //we can only paint the lower half of the spectrum
-        for(int index = 0; index < 512; ++index)
+        if(!woken)
         {
-            //paint the pixels
-            painter.setPen(QPen(QColor::fromRgb(redChannel[index], 0, 0), 1));
-            painter.drawPoint(index, 0);
-            painter.setPen(QPen(QColor::fromRgb(waveData[index], 0, 0), 1));
-            painter.drawPoint(index, 1);
+            // nothing is analysed while idle, keep the newest frame and let
+            // the rest go so the realtime thread never finds the ring full
+            if(idle)
+            {
+                const quint64 channels = data->ringLayout.load(std::memory_order_acquire) & impl::LayoutChannelMask;
+                const quint64 frame = data->analyzer ? data->analyzer->size() : MaximumFftSize;
+
+                data->samples.trim(frame * channels);
+            }
+
+            continue;
         }
 
-        painter.end();
+        // collapse any wakeups that piled up while we were busy
+        m_analysisWake.tryAcquire(m_analysisWake.available());
+
+        // the stream format, the analysis settings or the ring layout changed
+        // since the analyzer was built
+        const quint64 generation = data->settingsGeneration.load(std::memory_order_acquire);
+        const quint64 layout = data->ringLayout.load(std::memory_order_acquire);
+
+        bool rebuild = generation != data->analyzerGeneration;
 
-        if(m_mutex.tryLock(4))
+        if(layout != data->analyzerLayout)
         {
-            m_instance->m_frame = audioTexture;
-            m_mutex.unlock();
+            data->analyzerLayout = layout;
+            data->samples.align(layout >> impl::LayoutChannelBits, layout & impl::LayoutChannelMask);
+            rebuild = true;
         }
+
+        if(rebuild)
+        {
+            data->analyzerGeneration = generation;
+            rebuildAnalyzer(data);
+        }
+
+        if(data->analyzer)
+            analyze(data);
     }
+}
 
-    pw_stream_queue_buffer(data->stream, b);
+void AudioModel::consumeSharedFrame()
+{
+    // worker only, like the analyzer texture it stands in for
+    static uchar frame[sizeof(m_frameData)];
+
+    QSize size;
+    qint64 captureTime = 0;
+    AudioFeatures::Values features;
+
+    if(m_sharedFrame->wait(m_sharedSequence, 100) && m_sharedFrame->read(frame, size, captureTime, features, m_sharedSequence))
+    {
+        publishFrame(frame, size, captureTime, features);
+        return;
+    }
+
+    // nothing for a while, either the producer is idle or it is gone and
+    // this process takes over the capture
+    if(m_sharedFrame->tryPromote())
+    {
+        qCDebug(KOMPLEX_AUDIO, "Taking over shared audio analysis");
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [] {
+            if(m_running.load(std::memory_order_acquire) && !m_thread->isRunning())
+                m_thread->start(QThread::NormalPriority);
+        }, Qt::QueuedConnection);
+    }
 }
 
-// Blackman window function
-std::vector<double> AudioModel::createBlackmanWindow(int size)
+void AudioModel::rebuildAnalyzer(impl *data)
 {
-    std::vector<double> window(size);
-    const double a0 = 0.42;
-    const double a1 = 0.5;
-    const double a2 = 0.08;
+    const quint32 rate = data->rate.load(std::memory_order_relaxed);
+    const quint32 channels = static_cast<quint32>(data->analyzerLayout & impl::LayoutChannelMask);
 
-    for (int i = 0; i < size; ++i) {
-        window[i] = a0 - a1 * std::cos(2.0 * M_PI * i / (size - 1)) +
-                    a2 * std::cos(4.0 * M_PI * i / (size - 1));
+    // no format negotiated yet
+    if(rate == 0)
+    {
+        data->analyzer.reset();
+        return;
     }
-    return window;
+
+    const int width = data->textureWidth.load(std::memory_order_relaxed);
+    const AudioAnalyzer::Mapping mapping = static_cast<AudioAnalyzer::Mapping>(data->spectrumMapping.load(std::memory_order_relaxed));
+
+    // the realtime thread decimates high rates, and the frame covers the
+    // same time as fftSize samples at the reference rate
+    const quint32 analysisRate = rate / AudioDecimator::factorFor(rate);
+    const int size = std::min(AudioAnalyzer::scaledSize(data->fftSize.load(std::memory_order_relaxed), analysisRate), MaximumFftSize * 2);
+
+    data->analyzer = std::make_unique<AudioAnalyzer>(size, analysisRate, channels, width, mapping);
 }
 
-// Simple smoothing function using moving average
-std::vector<float> AudioModel::smoothData(const std::vector<float>& data, int windowSize) {
-    std::vector<float> smoothed(data.size());
+void AudioModel::analyze(impl *data)
+{
+    // take the newest fftSize samples of every channel, a new frame is
+    // available every hopSize samples. the analyzer does the rest
+    AudioAnalyzer *analyzer = data->analyzer.get();
+    const quint64 channels = analyzer->channels();
+    const quint64 hopSize = analyzer->scaled(static_cast<int>(data->hopSize.load(std::memory_order_relaxed)));
 
-    for (size_t i = 0; i < data.size(); ++i) {
-        float sum = 0.0f;
-        int count = 0;
+    const quint64 hops = data->samples.read(analyzer->frame(), analyzer->size() * channels, hopSize * channels);
 
-        for (int j = -windowSize/2; j <= windowSize/2; ++j) {
-            int idx = i + j;
-            if (idx >= 0 && idx < static_cast<int>(data.size())) {
-                sum += data[idx];
-                count++;
-            }
-        }
+    if(hops == 0)
+        return;
 
-        smoothed[i] = count > 0 ? sum / count : 0.0f;
-    }
+    // the time since the previous frame. every wake analyses one frame and
+    // the hops the worker was too late for are skipped, with a quantum above
+    // the hop size that is several hops per frame
+    const float frameSeconds = static_cast<float>(hops * std::min<quint64>(hopSize, analyzer->size())) / analyzer->rate();
+
+    const float timeConstant = data->smoothingTimeConstant.load(std::memory_order_relaxed);
+    const float peakDecay = data->peakDecay.load(std::memory_order_relaxed);
+
+    // dB per second to a linear factor for the time since the previous frame
+    const float peakFactor = peakDecay > 0.0f ? std::pow(10.0f, -peakDecay * frameSeconds / 20.0f) : 0.0f;
+
+    const qint64 captureTime = data->captureTime.load(std::memory_order_relaxed);
+
+    // the frame is built in the analyzer's own buffer and copied out in
+    // one go once complete
+    analyzer->analyze(timeConstant, peakFactor, frameSeconds);
 
-    return smoothed;
+    publishFrame(analyzer->texture(), analyzer->textureSize(), captureTime, analyzer->features());
 }
 
 void AudioModel::do_quit(void *userdata, int signal_number)
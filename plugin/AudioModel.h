@@ -7,14 +7,9 @@
  *  This is pretty much just a reimplementation of the audiocapture example
  *  from the PipeWire docs.
  * 
- *  NOTICE:
- *  The spectrum data is currently out of spec according to the documentation
+ *  The spectrum is smoothed over time per bin as described in
  *  https://webaudio.github.io/web-audio-api/#smoothing-over-time
- * 
- *  The described smoothing method was resulting in inconsistent data. This
- *  is likely due to a poor implementation. A linear smoothing algo seems to work
- *  (at least visually). Will need to revisit the temporal implementation if 
- *  things do not work as expected.
+ *  with the same 0.8 default time constant ShaderToy gets from the browser.
  *
  *  This program is free software: you can redistribute it and/or modify
  *  it under the terms of the GNU General Public License as published by
@@ -43,19 +38,23 @@
 #include <QJsonParseError>
 #include <QThread>
 #include <QtEndian>
-#include <QPixmap>
+#include <QImage>
 #include <QQmlEngine>
 #include <QJSValue>
 #include <QVector>
-#include <QPainter>
-#include <QBrush>
-#include <QPen>
 #include <QThread>
-#include <QMutex>
+#include <QSemaphore>
 #include <QtConcurrent/QtConcurrent>
 #include <QtQml/qqmlregistration.h>
 
+#include "AudioAnalyzer.h"
+#include "AudioDecimator.h"
+#include "AudioRingBuffer.h"
+#include "AudioSharedFrame.h"
+
+#include <atomic>
 #include <complex>
+#include <memory>
 #include <pipewire/pipewire.h>
 #include <spa/param/audio/raw.h>
 #include <spa/pod/pod.h>
@@ -70,55 +69,374 @@ class KOMPLEX_EXPORT AudioModel : public QObject
     QML_SINGLETON
     QML_NAMED_ELEMENT(AudioModel)
 
+    Q_PROPERTY(int hopSize READ hopSize WRITE setHopSize NOTIFY hopSizeChanged)
+    Q_PROPERTY(int analysisPriority READ analysisPriority WRITE setAnalysisPriority NOTIFY analysisPriorityChanged)
+    Q_PROPERTY(int fftSize READ fftSize WRITE setFftSize NOTIFY fftSizeChanged)
+    Q_PROPERTY(int textureWidth READ textureWidth WRITE setTextureWidth NOTIFY textureWidthChanged)
+    Q_PROPERTY(SpectrumMapping spectrumMapping READ spectrumMapping WRITE setSpectrumMapping NOTIFY spectrumMappingChanged)
+    Q_PROPERTY(qreal smoothingTimeConstant READ smoothingTimeConstant WRITE setSmoothingTimeConstant NOTIFY smoothingTimeConstantChanged)
+    Q_PROPERTY(qreal peakDecay READ peakDecay WRITE setPeakDecay NOTIFY peakDecayChanged)
+    Q_PROPERTY(qreal silenceThreshold READ silenceThreshold WRITE setSilenceThreshold NOTIFY silenceThresholdChanged)
+    Q_PROPERTY(qreal idleTimeout READ idleTimeout WRITE setIdleTimeout NOTIFY idleTimeoutChanged)
+    Q_PROPERTY(bool idle READ isIdle NOTIFY idleChanged)
+    Q_PROPERTY(ChannelMode channelMode READ channelMode WRITE setChannelMode NOTIFY channelModeChanged)
+    Q_PROPERTY(QString targetNode READ targetNode WRITE setTargetNode NOTIFY targetNodeChanged)
+    Q_PROPERTY(bool sharedAnalysis READ sharedAnalysis WRITE setSharedAnalysis NOTIFY sharedAnalysisChanged)
+
 public:
+    // mirrors AudioAnalyzer::Mapping
+    enum SpectrumMapping
+    {
+        Linear = AudioAnalyzer::Linear,
+        Logarithmic = AudioAnalyzer::Logarithmic,
+        Mel = AudioAnalyzer::Mel,
+        Bark = AudioAnalyzer::Bark
+    };
+    Q_ENUM(SpectrumMapping)
+
+    enum ChannelMode
+    {
+        Mono, // every channel mixed down, the ShaderToy layout
+        Stereo, // left and right analysed separately
+        AllChannels // every channel of the node analysed separately, up to MaximumChannels
+    };
+    Q_ENUM(ChannelMode)
+
     AudioModel(QObject *parent = nullptr);
     ~AudioModel();
 
+    // default size of the ShaderToy compatible audio texture
+    static constexpr int AudioTextureWidth = 512;
+    static constexpr int AudioTextureHeight = 2;
+
+    // limits of the configurable analysis
+    static constexpr int MinimumTextureWidth = 16;
+    static constexpr int MaximumTextureWidth = 4096;
+    static constexpr int MinimumFftSize = 512;
+    static constexpr int MaximumFftSize = 8192;
+    static constexpr int MaximumChannels = 8;
+    static constexpr int MaximumTextureHeight = MaximumChannels * 2;
+
+    struct FrameInfo
+    {
+        quint64 sequence = 0; // increases by one for every published frame, 0 means none yet
+        qint64 captureTime = 0; // std::chrono::steady_clock nanoseconds when the newest sample was captured
+        AudioFeatures::Values features; // derived from the same analysis frame
+    };
+
     /**!
      * @brief frame
-     * This function returns the current audio frame as a QPixmap.
-     * It is expected to be called after the frameChanged signal is emitted, if using from CPP
+     * This function returns the current audio frame as a 8-bit grayscale QImage.
+     * Row 0 holds the spectrum and row 1 the waveform, the width follows
+     * textureWidth. When channels are analysed separately every channel adds
+     * another spectrum and waveform row pair, in stream channel order.
+     * It is expected to be called after the frameReady signal is emitted, if using from CPP
      *
      * If it is being used from QML, it will need to be resolved from the AuidoTexture Image Provider (image:/audio/frame#.jpg).
      * See AudioImage provider for more details.
      * 
-     * @return QPixmap containing the current audio frame.
+     * @return QImage containing the current audio frame.
+     */
+    static QImage frame();
+
+    /**!
+     * @brief readFrame
+     * Copies the current audio frame into destination, reusing its storage
+     * when the size and format already match. The size can change at any
+     * frame when textureWidth is changed. The copy is consistent, it
+     * never mixes two frames, and it never blocks the analysis worker.
+     *
+     * @param destination Image to copy the frame into
+     * @param info Optional sequence and capture time of the copied frame
+     *
+     * @return false if no frame has been published yet
+     */
+    static bool readFrame(QImage &destination, FrameInfo *info = nullptr);
+
+    /**!
+     * @brief frameSequence
+     * Sequence number of the newest published frame. Consumers can compare it
+     * against the last one they used to skip redundant uploads.
+     */
+    static quint64 frameSequence();
+
+    /**!
+     * @brief features
+     * Band levels, onsets, tempo and loudness of the newest frame. Cheaper
+     * than readFrame() for callers that only need these.
+     */
+    static AudioFeatures::Values features();
+
+    /**!
+     * @brief instance
+     * The process wide AudioModel, or nullptr if capture was never started.
+     * Useful for connecting to frameReady from C++.
      */
-    static QPixmap frame();
+    static AudioModel *instance() { return m_instance; }
 
     // Q_INVOKABLE bool init();
     Q_INVOKABLE static void startCapture();
     Q_INVOKABLE static void stopCapture();
 
+    /**!
+     * @brief suspendCapture
+     * Marks one capture client as paused. Once every client is paused the
+     * stream is deactivated and PipeWire stops delivering buffers until one
+     * of them calls resumeCapture().
+     */
+    Q_INVOKABLE static void suspendCapture();
+    Q_INVOKABLE static void resumeCapture();
+
+    /**!
+     * @brief hopSize
+     * Number of captured samples between the start of two analysis frames.
+     * Frames are fftSize samples long, so anything below that overlaps them
+     * and raises the spectrum update rate. Counted at 44.1kHz like fftSize.
+     */
+    int hopSize() const;
+    void setHopSize(int hopSize);
+
+    /**!
+     * @brief analysisPriority
+     * Scheduling priority of the analysis worker. The capture callback itself
+     * always runs on the PipeWire realtime thread.
+     *
+     * Accepts the values of QThread::Priority.
+     */
+    int analysisPriority() const;
+    void setAnalysisPriority(int priority);
+
+    /**!
+     * @brief fftSize
+     * Samples per analysis frame, a power of two between 512 and 8192.
+     * Larger frames resolve bass better at the cost of time resolution.
+     *
+     * Counted at AudioAnalyzer::ReferenceRate. At any other graph rate the
+     * frame is resized to span the same time, so the bins keep their width
+     * and the texture its meaning. Rates above 50kHz are decimated first.
+     */
+    int fftSize() const;
+    void setFftSize(int size);
+
+    /**!
+     * @brief textureWidth
+     * Columns of the audio texture, between 16 and 4096. Packs that only use
+     * a handful of bands can ask for a narrow texture and cheaper uploads.
+     */
+    int textureWidth() const;
+    void setTextureWidth(int width);
+
+    /**!
+     * @brief spectrumMapping
+     * Frequency scale of the spectrum row. Linear keeps the ShaderToy layout,
+     * the others spread 20Hz-20kHz over the columns on a log, mel or bark
+     * scale.
+     */
+    SpectrumMapping spectrumMapping() const;
+    void setSpectrumMapping(SpectrumMapping mapping);
+
+    /**!
+     * @brief smoothingTimeConstant
+     * Weight of the previous frame when smoothing the spectrum, between 0
+     * (no smoothing) and 1. Same meaning as AnalyserNode.smoothingTimeConstant,
+     * applied once per analysis frame.
+     */
+    qreal smoothingTimeConstant() const;
+    void setSmoothingTimeConstant(qreal timeConstant);
+
+    /**!
+     * @brief peakDecay
+     * When above 0, every spectrum column holds its peak and lets it fall at
+     * this many dB per second. 0 disables peak hold.
+     */
+    qreal peakDecay() const;
+    void setPeakDecay(qreal decibelsPerSecond);
+
+    /**!
+     * @brief silenceThreshold
+     * RMS level in dBFS below which a capture buffer counts as silent.
+     */
+    qreal silenceThreshold() const;
+    void setSilenceThreshold(qreal decibels);
+
+    /**!
+     * @brief idleTimeout
+     * Seconds of continuous silence after which analysis stops and no more
+     * frames are published. The first buffer above the threshold resumes
+     * it. 0 disables idle detection.
+     */
+    qreal idleTimeout() const;
+    void setIdleTimeout(qreal seconds);
+
+    /**!
+     * @brief isIdle
+     * True while analysis is stopped because of silence.
+     */
+    bool isIdle() const;
+
+    /**!
+     * @brief channelMode
+     * Whether channels are mixed down or analysed separately. Switching to
+     * or from AllChannels renegotiates the stream format.
+     */
+    ChannelMode channelMode() const;
+    void setChannelMode(ChannelMode mode);
+
+    /**!
+     * @brief targetNode
+     * node.name or object.serial of the PipeWire node to capture, a sink or
+     * an application stream. Empty follows the default sink monitor.
+     */
+    QString targetNode() const;
+    void setTargetNode(const QString &target);
+
+    /**!
+     * @brief sharedAnalysis
+     * Shares one capture stream and analysis between every process of the
+     * user through AudioSharedFrame. Only the process that ends up producing
+     * runs PipeWire and the FFT, the others copy its frames and ignore their
+     * own analysis settings. Applied the next time capture starts.
+     */
+    bool sharedAnalysis() const;
+    void setSharedAnalysis(bool shared);
+
+    /**!
+     * @brief shareAnalysis
+     * sharedAnalysis for callers without an instance, before capture starts.
+     */
+    static void shareAnalysis(bool shared);
+
+Q_SIGNALS:
+    /**!
+     * @brief frameReady
+     * Emitted from the analysis worker every time a new frame has been
+     * published. Connect with a queued connection.
+     *
+     * @param sequence Sequence number of the published frame
+     */
+    void frameReady(quint64 sequence);
+
+    void hopSizeChanged();
+    void analysisPriorityChanged();
+    void fftSizeChanged();
+    void textureWidthChanged();
+    void spectrumMappingChanged();
+    void smoothingTimeConstantChanged();
+    void peakDecayChanged();
+    void silenceThresholdChanged();
+    void idleTimeoutChanged();
+
+    // emitted from the analysis worker
+    void idleChanged();
+
+    void channelModeChanged();
+    void targetNodeChanged();
+    void sharedAnalysisChanged();
+
 private Q_SLOTS:
     static void startCaptureAsync();
 
 private:
-    static std::vector<double> createBlackmanWindow(int size);
-    static std::vector<float> smoothData(const std::vector<float>& data, int windowSize = 5);
-
     struct impl
     {
-        pw_main_loop *loop;
-        pw_stream *stream;
+        pw_main_loop *loop = nullptr;
+        pw_stream *stream = nullptr;
+
+        spa_audio_info format = {};
+        unsigned move:1 = 1;
 
-        spa_audio_info format;
-        unsigned move:1;
+        // capture converted to the analysed channels, written by the realtime thread
+        AudioRingBuffer samples {MaximumFftSize * MaximumChannels * 2};
+        std::atomic<quint64> hopSize = 512; // analysis frames overlap, one frame every hop
+        std::atomic<qint64> captureTime = 0; // steady clock time of the last commit to samples
 
-        QVector<qreal> samples; // we need at least 2048 samples
-        QVector<qreal> smoothed; // we're supposed to save for smoothing, but I couldn't get this method to work
-        qreal last;
+        // applied every frame, changing them does not rebuild the analyzer
+        std::atomic<float> smoothingTimeConstant = 0.8f;
+        std::atomic<float> peakDecay = 0.0f; // dB per second, 0 is off
+
+        // idle detection. the realtime thread counts silent frames and flips
+        // idle, the worker notices and reports it
+        std::atomic<float> silenceLevel = 1e-6f; // mean square of the threshold, -60dBFS
+        std::atomic<float> idleTimeout = 2.0f;
+        std::atomic<bool> idle = false;
+        quint64 silentFrames = 0; // realtime thread only
+        bool reportedIdle = false; // analysis worker only
+
+        // the realtime thread decides how many channels go into the ring. when
+        // that changes it publishes the ring position the new interleaving
+        // starts at, packed as (position << LayoutChannelBits) | channels
+        static constexpr quint64 LayoutChannelBits = 4;
+        static constexpr quint64 LayoutChannelMask = (1 << LayoutChannelBits) - 1;
+
+        std::atomic<int> channelMode = Mono;
+        std::atomic<quint64> ringLayout = 1;
+        quint32 ringChannels = 1; // realtime thread only
+
+        // graph rates far above the reference rate are decimated on the
+        // realtime thread, through scratch buffers sized up front
+        static constexpr quint64 ScratchFrames = 4096;
+
+        AudioDecimator decimator; // realtime thread only
+        std::vector<float> converted = std::vector<float>(ScratchFrames * MaximumChannels);
+        std::vector<float> decimated = std::vector<float>(ScratchFrames * MaximumChannels);
+        quint64 analyzerLayout = 1; // analysis worker only
+
+        // analysis settings, written by the PipeWire loop (format) and the
+        // property setters. every change bumps settingsGeneration
+        std::atomic<quint32> rate = 0;
+        std::atomic<quint32> channels = 0;
+        std::atomic<int> fftSize = 2048;
+        std::atomic<int> textureWidth = AudioTextureWidth;
+        std::atomic<int> spectrumMapping = Linear;
+        std::atomic<quint64> settingsGeneration = 0;
+
+        // the analyzer is owned by the analysis worker, which rebuilds it at
+        // a frame boundary whenever the settings generation moves on
+        std::unique_ptr<AudioAnalyzer> analyzer;
+        quint64 analyzerGeneration = 0;
     };
 
     inline static AudioModel *m_instance = nullptr;
     inline static QThread *m_thread = nullptr;
-    inline static QMutex m_mutex;
+    inline static QThread *m_analysisThread = nullptr;
+    inline static QThread::Priority m_analysisPriority = QThread::HighPriority;
+    inline static QSemaphore m_analysisWake;
     inline static quint64 m_clients = 0; // used to track 
+    inline static quint64 m_suspendedClients = 0;
+    inline static QByteArray m_targetNode;
+
+    // set while another process may produce the frames. created when capture
+    // starts, owned by the analysis worker from then on
+    inline static bool m_sharedAnalysis = false;
+    inline static std::unique_ptr<AudioSharedFrame> m_sharedFrame;
+    inline static quint64 m_sharedSequence = 0;
+
+    // seqlock protected copy of the newest frame. m_frameLock is odd while the
+    // worker copies a frame in, readers retry until it is even and unchanged.
+    // the frame sequence number is m_frameLock / 2
+    inline static std::atomic<quint64> m_frameLock = 0;
+    inline static uchar m_frameData[MaximumTextureWidth * MaximumTextureHeight] = {};
+    inline static std::atomic<int> m_frameWidth = AudioTextureWidth;
+    inline static std::atomic<int> m_frameHeight = AudioTextureHeight;
+    inline static std::atomic<qint64> m_frameCaptureTime = 0;
+    inline static AudioFeatures::Values m_frameFeatures;
 
-    QPixmap m_frame;
+    static void publishFrame(const uchar *data, QSize size, qint64 captureTime, const AudioFeatures::Values &features);
 
     inline static impl m_impl_data;
-    inline static bool m_running = false;
+    inline static std::atomic<bool> m_running = false;
+
+    static void analysisLoop();
+    static void rebuildAnalyzer(impl *data);
+    static void analyze(impl *data);
+    static void consumeSharedFrame();
+
+    static void updateStreamActive();
+    static int do_set_active(struct spa_loop *loop, bool async, uint32_t seq, const void *data, size_t size, void *user_data);
+
+    static void connectStream(impl *data);
+    static void reconnectStream();
+    static int do_reconnect(struct spa_loop *loop, bool async, uint32_t seq, const void *data, size_t size, void *user_data);
 
     static void on_process(void *user_data);
     static void do_quit(void *user_data, int signal_number);
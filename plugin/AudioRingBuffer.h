@@ -0,0 +1,265 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  AudioRingBuffer.h
+ *
+ *  Fixed capacity single producer, single consumer ring buffer for the
+ *  captured audio. The producer is the PipeWire realtime thread, so neither
+ *  side ever locks or allocates once the buffer has been constructed.
+ *
+ *  The consumer reads analysis frames through a hop sized cursor, which lets
+ *  frames overlap (eg. 2048 sample windows every 512 samples).
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+
+class AudioRingBuffer
+{
+public:
+    /**!
+     * @brief AudioRingBuffer
+     * Allocates the backing storage. The capacity is rounded up to the next
+     * power of two so the cursors can be wrapped with a mask.
+     *
+     * @param capacity Minimum number of samples the buffer can hold
+     */
+    explicit AudioRingBuffer(quint64 capacity)
+        : m_capacity(std::bit_ceil(capacity)),
+        m_mask(m_capacity - 1),
+        m_data(new float[m_capacity]())
+    {
+    }
+
+    AudioRingBuffer(const AudioRingBuffer &) = delete;
+    AudioRingBuffer &operator=(const AudioRingBuffer &) = delete;
+
+    quint64 capacity() const { return m_capacity; }
+
+    /**!
+     * @brief push
+     * Producer side. Stages a sample without making it visible to the
+     * consumer, call commit() once the whole buffer has been pushed.
+     *
+     * @return false if the buffer is full and the sample was dropped
+     */
+    inline bool push(float sample)
+    {
+        if(m_pending - m_read.load(std::memory_order_acquire) >= m_capacity)
+        {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_data[m_pending & m_mask] = sample;
+        ++m_pending;
+
+        return true;
+    }
+
+    /**!
+     * @brief space
+     * Producer side. Number of samples that can be staged before the
+     * buffer is full.
+     */
+    inline quint64 space() const
+    {
+        return m_capacity - (m_pending - m_read.load(std::memory_order_acquire));
+    }
+
+    /**!
+     * @brief writeSpan
+     * Producer side. Returns the largest contiguous block of free space at
+     * the write cursor, so a kernel can fill it directly. Call advance()
+     * with the number of samples actually written.
+     *
+     * @param count Set to the number of samples that fit in the block
+     */
+    inline float *writeSpan(quint64 &count)
+    {
+        const quint64 free = m_capacity - (m_pending - m_read.load(std::memory_order_acquire));
+        const quint64 start = m_pending & m_mask;
+
+        count = std::min(free, m_capacity - start);
+
+        return m_data.get() + start;
+    }
+
+    /**!
+     * @brief advance
+     * Producer side. Stages count samples written through writeSpan().
+     */
+    inline void advance(quint64 count)
+    {
+        m_pending += count;
+    }
+
+    /**!
+     * @brief write
+     * Producer side. Stages a block of samples, wrapping as needed. The
+     * caller checks space() first, whatever does not fit is left out.
+     */
+    inline void write(const float *source, quint64 count)
+    {
+        while(count > 0)
+        {
+            quint64 span = 0;
+            float *destination = writeSpan(span);
+
+            span = std::min(span, count);
+
+            if(span == 0)
+                break;
+
+            std::memcpy(destination, source, span * sizeof(float));
+            advance(span);
+
+            source += span;
+            count -= span;
+        }
+    }
+
+    /**!
+     * @brief drop
+     * Producer side. Records samples that did not fit in the buffer.
+     */
+    inline void drop(quint64 count)
+    {
+        m_overruns.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /**!
+     * @brief position
+     * Producer side. Total number of samples staged so far, the position the
+     * next sample will be written at.
+     */
+    inline quint64 position() const
+    {
+        return m_pending;
+    }
+
+    /**!
+     * @brief commit
+     * Producer side. Publishes every sample staged with push() or advance().
+     */
+    inline void commit()
+    {
+        m_write.store(m_pending, std::memory_order_release);
+    }
+
+    /**!
+     * @brief read
+     * Consumer side. Copies the newest complete frame into destination and
+     * advances the read cursor by whole hops. If the consumer fell behind by
+     * more than one hop the stale hops are skipped, only the latest frame is
+     * interesting for visualisation.
+     *
+     * @param destination Buffer of at least frameSize samples
+     * @param frameSize Number of samples in an analysis frame
+     * @param hopSize Distance between the start of two consecutive frames
+     *
+     * @return Number of hops the frame starts past the previous one, 0 if
+     * less than frameSize samples are available
+     */
+    quint64 read(float *destination, quint64 frameSize, quint64 hopSize)
+    {
+        hopSize = std::clamp<quint64>(hopSize, 1, frameSize);
+
+        const quint64 write = m_write.load(std::memory_order_acquire);
+        quint64 read = m_read.load(std::memory_order_relaxed);
+
+        if(write - read < frameSize)
+            return 0;
+
+        // skip to the newest frame that is still complete
+        const quint64 skipped = (write - read - frameSize) / hopSize;
+        read += skipped * hopSize;
+
+        const quint64 start = read & m_mask;
+        const quint64 first = std::min(frameSize, m_capacity - start);
+
+        std::memcpy(destination, m_data.get() + start, first * sizeof(float));
+        std::memcpy(destination + first, m_data.get(), (frameSize - first) * sizeof(float));
+
+        m_read.store(read + hopSize, std::memory_order_release);
+
+        return skipped + 1;
+    }
+
+    /**!
+     * @brief align
+     * Consumer side. Moves the read cursor to start, or to the first
+     * multiple of stride past start if it is already beyond it. Used when
+     * the producer switches to frames of stride interleaved samples from
+     * position start, so reads never begin in the middle of a frame.
+     */
+    void align(quint64 start, quint64 stride)
+    {
+        quint64 read = m_read.load(std::memory_order_relaxed);
+
+        if(read <= start)
+            read = start;
+        else
+            read = start + ((read - start + stride - 1) / stride) * stride;
+
+        m_read.store(std::min(read, m_write.load(std::memory_order_acquire)), std::memory_order_release);
+    }
+
+    /**!
+     * @brief trim
+     * Consumer side. Skips everything but the newest keep samples, for when
+     * nothing is read for a while but the producer must not run out of
+     * space. keep should be a multiple of the interleaving so the cursor
+     * stays on a frame boundary.
+     */
+    void trim(quint64 keep)
+    {
+        const quint64 write = m_write.load(std::memory_order_acquire);
+        const quint64 read = m_read.load(std::memory_order_relaxed);
+
+        if(write - read > keep)
+            m_read.store(write - keep, std::memory_order_release);
+    }
+
+    /**!
+     * @brief takeOverruns
+     * Consumer side. Number of samples the producer had to drop because the
+     * consumer did not keep up, since the last call.
+     */
+    quint64 takeOverruns() { return m_overruns.exchange(0, std::memory_order_relaxed); }
+
+private:
+    const quint64 m_capacity;
+    const quint64 m_mask;
+    std::unique_ptr<float[]> m_data;
+
+    quint64 m_pending = 0; // producer owned
+    std::atomic<quint64> m_overruns = 0;
+
+    alignas(64) std::atomic<quint64> m_write = 0;
+    alignas(64) std::atomic<quint64> m_read = 0;
+};
+
+#endif // AUDIORINGBUFFER_H
@@ -0,0 +1,264 @@
+#include "AudioSharedFrame.h"
+
+#include <QFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+// frame data starts on the cache line after the header
+constexpr size_t DataOffset = sizeof(AudioSharedFrame::Header);
+
+QByteArray segmentName()
+{
+    return QByteArrayLiteral("/komplex-audio-") + QByteArray::number(getuid());
+}
+
+// shared (not private) futex, the waiters live in other processes
+long futex(std::atomic<quint32> *address, int operation, quint32 value, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, reinterpret_cast<quint32 *>(address), operation, value, timeout, nullptr, 0);
+}
+}
+
+std::unique_ptr<AudioSharedFrame> AudioSharedFrame::open(quint32 capacity)
+{
+    const QString runtime = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+
+    if(runtime.isEmpty())
+        return nullptr;
+
+    const QByteArray path = QFile::encodeName(runtime + QStringLiteral("/komplex-audio.lock"));
+    const int lockFile = ::open(path.constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    if(lockFile < 0)
+    {
+        qWarning("Could not open %s, audio analysis will not be shared", path.constData());
+        return nullptr;
+    }
+
+    std::unique_ptr<AudioSharedFrame> frame(new AudioSharedFrame(lockFile, capacity));
+
+    if(frame->tryLock())
+    {
+        frame->m_role.store(Producer, std::memory_order_release);
+
+        if(!frame->map(true))
+            return nullptr;
+    }
+    else
+        frame->map(false); // attached later if the producer is still setting up
+
+    return frame;
+}
+
+AudioSharedFrame::AudioSharedFrame(int lockFile, quint32 capacity)
+    : m_lockFile(lockFile),
+    m_capacity(capacity)
+{
+}
+
+AudioSharedFrame::~AudioSharedFrame()
+{
+    unmap();
+
+    // the segment is left in place, consumers keep their mapping and the
+    // next producer reuses it. closing the file releases the lock
+    if(m_lockFile >= 0)
+        ::close(m_lockFile);
+}
+
+bool AudioSharedFrame::tryLock()
+{
+    return flock(m_lockFile, LOCK_EX | LOCK_NB) == 0;
+}
+
+bool AudioSharedFrame::map(bool writable)
+{
+    unmap();
+
+    const QByteArray name = segmentName();
+    const int segment = shm_open(name.constData(), writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0600);
+
+    if(segment < 0)
+        return false;
+
+    struct stat info;
+    size_t size = DataOffset + m_capacity;
+
+    if(writable)
+    {
+        if(ftruncate(segment, size) != 0)
+        {
+            ::close(segment);
+            return false;
+        }
+    }
+    else if(fstat(segment, &info) != 0 || static_cast<size_t>(info.st_size) < DataOffset)
+    {
+        ::close(segment);
+        return false;
+    }
+    else
+        size = info.st_size;
+
+    void *address = mmap(nullptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, segment, 0);
+    ::close(segment);
+
+    if(address == MAP_FAILED)
+        return false;
+
+    m_header = static_cast<Header *>(address);
+    m_mappedSize = size;
+
+    if(writable)
+    {
+        m_header->magic = Magic;
+        m_header->version = Version;
+        m_header->capacity = m_capacity;
+
+        // a producer that died mid frame leaves the lock odd
+        const quint64 lock = m_header->lock.load(std::memory_order_relaxed);
+
+        if(lock & 1)
+            m_header->lock.store(lock + 1, std::memory_order_release);
+    }
+    else if(m_header->magic != Magic || m_header->version != Version)
+    {
+        unmap();
+        return false;
+    }
+
+    return true;
+}
+
+void AudioSharedFrame::unmap()
+{
+    if(m_header)
+        munmap(m_header, m_mappedSize);
+
+    m_header = nullptr;
+    m_mappedSize = 0;
+}
+
+void AudioSharedFrame::publish(const uchar *data, QSize size, qint64 captureTime, const AudioFeatures::Values &features)
+{
+    const quint32 bytes = size.width() * size.height();
+
+    if(role() != Producer || !m_header || bytes > m_capacity)
+        return;
+
+    uchar *frame = reinterpret_cast<uchar *>(m_header) + DataOffset;
+    const quint64 lock = m_header->lock.load(std::memory_order_relaxed);
+
+    m_header->lock.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(frame, data, bytes);
+    m_header->width.store(size.width(), std::memory_order_relaxed);
+    m_header->height.store(size.height(), std::memory_order_relaxed);
+    m_header->captureTime.store(captureTime, std::memory_order_relaxed);
+    std::memcpy(&m_header->features, &features, sizeof(features));
+
+    m_header->lock.store(lock + 2, std::memory_order_release);
+
+    m_header->wake.fetch_add(1, std::memory_order_release);
+    futex(&m_header->wake, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+bool AudioSharedFrame::wait(quint64 sequence, int timeout)
+{
+    const struct timespec duration = { timeout / 1000, (timeout % 1000) * 1000000L };
+
+    // the producer may not have created the segment yet
+    if(!m_header && !map(false))
+    {
+        nanosleep(&duration, nullptr);
+        return false;
+    }
+
+    const quint32 wake = m_header->wake.load(std::memory_order_acquire);
+
+    if(m_header->lock.load(std::memory_order_acquire) / 2 != sequence)
+        return true;
+
+    // returns early if wake already moved on since it was loaded
+    futex(&m_header->wake, FUTEX_WAIT, wake, &duration);
+
+    return m_header->lock.load(std::memory_order_acquire) / 2 != sequence;
+}
+
+bool AudioSharedFrame::read(uchar *destination, QSize &size, qint64 &captureTime, AudioFeatures::Values &features, quint64 &sequence) const
+{
+    if(!m_header)
+        return false;
+
+    const uchar *frame = reinterpret_cast<const uchar *>(m_header) + DataOffset;
+    const size_t capacity = m_mappedSize - DataOffset;
+
+    // a producer that dies mid frame never makes the lock even again
+    for(int attempt = 0; attempt < 1024; ++attempt)
+    {
+        const quint64 lock = m_header->lock.load(std::memory_order_acquire);
+
+        if(lock & 1)
+        {
+            sched_yield();
+            continue;
+        }
+
+        const int width = m_header->width.load(std::memory_order_relaxed);
+        const int height = m_header->height.load(std::memory_order_relaxed);
+        const size_t bytes = size_t(std::max(width, 0)) * size_t(std::max(height, 0));
+
+        if(bytes > capacity || bytes > m_capacity)
+            return false;
+
+        std::memcpy(destination, frame, bytes);
+        captureTime = m_header->captureTime.load(std::memory_order_relaxed);
+        std::memcpy(&features, &m_header->features, sizeof(features));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(m_header->lock.load(std::memory_order_relaxed) != lock)
+            continue;
+
+        size = QSize(width, height);
+        sequence = lock / 2;
+
+        return lock != 0;
+    }
+
+    return false;
+}
+
+bool AudioSharedFrame::tryPromote()
+{
+    if(role() == Producer)
+        return true;
+
+    if(!tryLock())
+        return false;
+
+    if(!map(true))
+    {
+        flock(m_lockFile, LOCK_UN);
+        return false;
+    }
+
+    m_role.store(Producer, std::memory_order_release);
+
+    return true;
+}
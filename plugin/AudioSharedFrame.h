@@ -0,0 +1,151 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  AudioSharedFrame.h
+ *
+ *  Shares the published audio frame between processes, so several
+ *  plasmashell instances and the config dialog preview can run a single
+ *  capture stream and FFT between them.
+ *
+ *  Whoever holds an exclusive flock() on $XDG_RUNTIME_DIR/komplex-audio.lock
+ *  is the producer and writes frames into the POSIX shared memory object
+ *  /komplex-audio-<uid>. Everyone else maps it read-only. The lock dies with
+ *  its process, so a consumer can take over when the producer goes away.
+ *
+ *  Segment layout, native endianness, for anything else that wants to act
+ *  as a producer or consumer:
+ *
+ *      offset  size  field
+ *      0       4     magic, 'KASF'
+ *      4       4     version, currently 2
+ *      8       4     wake, bumped after every frame, consumers FUTEX_WAIT on it
+ *      12      4     capacity of the frame data in bytes
+ *      16      8     seqlock, odd while a frame is written, frame sequence is lock / 2
+ *      24      4     frame width
+ *      28      4     frame height
+ *      32      8     capture time, steady clock nanoseconds
+ *      40      36    AudioFeatures::Values, nine floats
+ *      128     ...   width * height 8-bit texels, row major
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef AUDIOSHAREDFRAME_H
+#define AUDIOSHAREDFRAME_H
+
+#include <QtGlobal>
+#include <QSize>
+
+#include "AudioFeatures.h"
+
+#include <atomic>
+#include <memory>
+
+class AudioSharedFrame
+{
+public:
+    enum Role
+    {
+        Producer,
+        Consumer
+    };
+
+    static constexpr quint32 Magic = 0x4653414B; // 'KASF'
+    static constexpr quint32 Version = 2;
+
+    struct alignas(64) Header
+    {
+        quint32 magic;
+        quint32 version;
+        std::atomic<quint32> wake;
+        quint32 capacity;
+        std::atomic<quint64> lock;
+        std::atomic<qint32> width;
+        std::atomic<qint32> height;
+        std::atomic<qint64> captureTime;
+        AudioFeatures::Values features;
+    };
+
+    /**!
+     * @brief open
+     * Becomes the producer if nobody else is, otherwise a consumer. A
+     * consumer whose producer has not created the segment yet attaches on
+     * a later wait().
+     *
+     * @param capacity Largest frame in bytes the producer may publish
+     *
+     * @return nullptr if the runtime directory cannot be used
+     */
+    static std::unique_ptr<AudioSharedFrame> open(quint32 capacity);
+    ~AudioSharedFrame();
+
+    AudioSharedFrame(const AudioSharedFrame &) = delete;
+    AudioSharedFrame &operator=(const AudioSharedFrame &) = delete;
+
+    // promotion happens on the consumer's thread, so others may read it meanwhile
+    Role role() const { return m_role.load(std::memory_order_acquire); }
+
+    /**!
+     * @brief publish
+     * Producer side. Copies a frame into the segment and wakes every
+     * consumer.
+     */
+    void publish(const uchar *data, QSize size, qint64 captureTime, const AudioFeatures::Values &features);
+
+    /**!
+     * @brief wait
+     * Consumer side. Blocks until a frame newer than sequence is published
+     * or the timeout passes.
+     *
+     * @return false on timeout
+     */
+    bool wait(quint64 sequence, int timeout);
+
+    /**!
+     * @brief read
+     * Consumer side. Copies the newest frame out of the segment, retrying
+     * while the producer is writing it.
+     *
+     * @param destination Buffer of at least capacity bytes
+     *
+     * @return false if nothing has been published yet or the frame never
+     * settled
+     */
+    bool read(uchar *destination, QSize &size, qint64 &captureTime, AudioFeatures::Values &features, quint64 &sequence) const;
+
+    /**!
+     * @brief tryPromote
+     * Consumer side. Takes over as producer if the previous one is gone.
+     *
+     * @return true if this is now the producer
+     */
+    bool tryPromote();
+
+private:
+    AudioSharedFrame(int lockFile, quint32 capacity);
+
+    bool tryLock();
+    bool map(bool writable);
+    void unmap();
+
+    std::atomic<Role> m_role = Consumer;
+    int m_lockFile = -1;
+    quint32 m_capacity = 0;
+
+    Header *m_header = nullptr;
+    size_t m_mappedSize = 0;
+};
+
+#endif // AUDIOSHAREDFRAME_H
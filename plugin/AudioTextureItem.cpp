@@ -0,0 +1,256 @@
+#include "AudioTextureItem.h"
+
+#include <QQuickWindow>
+#include <QRunnable>
+#include <QSGSimpleTextureNode>
+#include <rhi/qrhi.h>
+
+#include "AudioModel.h"
+
+AudioTexture::AudioTexture()
+{
+    updateFrame();
+}
+
+AudioTexture::~AudioTexture()
+{
+    delete m_texture;
+}
+
+qint64 AudioTexture::comparisonKey() const
+{
+    if(m_texture)
+        return qint64(qintptr(m_texture));
+
+    return qint64(qintptr(this));
+}
+
+QRhiTexture *AudioTexture::rhiTexture() const
+{
+    return m_texture;
+}
+
+QSize AudioTexture::textureSize() const
+{
+    return m_frame.size();
+}
+
+bool AudioTexture::hasAlphaChannel() const
+{
+    return false;
+}
+
+bool AudioTexture::hasMipmaps() const
+{
+    return false;
+}
+
+quint64 AudioTexture::updateFrame()
+{
+    AudioModel::FrameInfo info;
+    AudioModel::readFrame(m_frame, &info);
+
+    m_dirty = true;
+
+    return info.sequence;
+}
+
+void AudioTexture::commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    // the texture is only (re)allocated if the frame size changes, every
+    // other frame is uploaded into the existing one
+    if(!m_texture || m_texture->pixelSize() != m_frame.size())
+    {
+        delete m_texture;
+
+        m_texture = rhi->newTexture(QRhiTexture::R8, m_frame.size());
+
+        if(!m_texture->create())
+        {
+            qWarning("Could not create the audio texture");
+            delete m_texture;
+            m_texture = nullptr;
+
+            return;
+        }
+
+        m_dirty = true;
+    }
+
+    if(!m_dirty)
+        return;
+
+    resourceUpdates->uploadTexture(m_texture, QRhiTextureUploadDescription({0, 0, QRhiTextureSubresourceUploadDescription(m_frame)}));
+    m_dirty = false;
+}
+
+// deletes the render thread objects on the render thread
+class AudioTextureCleanup : public QRunnable
+{
+public:
+    AudioTextureCleanup(AudioTexture *texture, AudioTextureProvider *provider)
+        : m_texture(texture),
+        m_provider(provider)
+    {
+    }
+
+    void run() override
+    {
+        delete m_provider;
+        delete m_texture;
+    }
+
+private:
+    AudioTexture *m_texture;
+    AudioTextureProvider *m_provider;
+};
+
+AudioTextureItem::AudioTextureItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+    setImplicitSize(AudioModel::AudioTextureWidth, AudioModel::AudioTextureHeight);
+}
+
+AudioTextureItem::~AudioTextureItem()
+{
+    if(m_capturing)
+    {
+        if(!m_active)
+            AudioModel::resumeCapture();
+
+        AudioModel::stopCapture();
+    }
+
+    if(window())
+        releaseResources();
+    else
+    {
+        delete m_provider;
+        delete m_texture;
+    }
+}
+
+void AudioTextureItem::componentComplete()
+{
+    QQuickItem::componentComplete();
+
+    if(m_sharedAnalysis)
+        AudioModel::shareAnalysis(true);
+
+    AudioModel::startCapture();
+    m_capturing = true;
+
+    if(!m_active)
+        AudioModel::suspendCapture();
+
+    // the analyzer signals from its worker thread, the queued polish() and
+    // update() let the next frame pick the features and the texture up
+    connect(AudioModel::instance(), &AudioModel::frameReady, this, &AudioTextureItem::frameReady, Qt::QueuedConnection);
+}
+
+void AudioTextureItem::frameReady()
+{
+    // analysis frames arrive faster than most displays refresh. the features
+    // are picked up once per rendered frame in updatePolish()
+    polish();
+    update();
+}
+
+void AudioTextureItem::updatePolish()
+{
+    const quint64 sequence = AudioModel::frameSequence();
+
+    if(sequence == m_featuresSequence)
+        return;
+
+    m_featuresSequence = sequence;
+    m_features = AudioModel::features();
+
+    Q_EMIT featuresChanged();
+}
+
+void AudioTextureItem::setActive(bool active)
+{
+    if(m_active == active)
+        return;
+
+    m_active = active;
+
+    // before componentComplete() there is no capture to suspend yet
+    if(m_capturing)
+    {
+        if(m_active)
+            AudioModel::resumeCapture();
+        else
+            AudioModel::suspendCapture();
+    }
+
+    Q_EMIT activeChanged();
+}
+
+void AudioTextureItem::setSharedAnalysis(bool shared)
+{
+    if(m_sharedAnalysis == shared)
+        return;
+
+    m_sharedAnalysis = shared;
+    Q_EMIT sharedAnalysisChanged();
+}
+
+QSGTextureProvider *AudioTextureItem::textureProvider() const
+{
+    ensureTexture();
+    return m_provider;
+}
+
+void AudioTextureItem::ensureTexture() const
+{
+    if(m_texture)
+        return;
+
+    m_texture = new AudioTexture;
+    m_provider = new AudioTextureProvider;
+    m_provider->setTexture(m_texture);
+}
+
+QSGNode *AudioTextureItem::updatePaintNode(QSGNode *node, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+
+    ensureTexture();
+
+    QSGSimpleTextureNode *textureNode = static_cast<QSGSimpleTextureNode *>(node);
+
+    if(!textureNode)
+    {
+        textureNode = new QSGSimpleTextureNode;
+        textureNode->setOwnsTexture(false);
+        textureNode->setTexture(m_texture);
+    }
+
+    // only upload frames the analyzer has not given us before
+    if(AudioModel::frameSequence() != m_frameSequence)
+    {
+        m_frameSequence = m_texture->updateFrame();
+
+        textureNode->markDirty(QSGNode::DirtyMaterial);
+        m_provider->notifyTextureChanged();
+    }
+
+    textureNode->setRect(boundingRect());
+
+    return textureNode;
+}
+
+void AudioTextureItem::releaseResources()
+{
+    if(!m_texture)
+        return;
+
+    window()->scheduleRenderJob(new AudioTextureCleanup(m_texture, m_provider), QQuickWindow::BeforeSynchronizingStage);
+
+    m_texture = nullptr;
+    m_provider = nullptr;
+    m_frameSequence = 0;
+}
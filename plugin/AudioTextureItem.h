@@ -0,0 +1,179 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  AudioTextureItem.h
+ *
+ *  QML item that presents the AudioModel frame as a single persistent GPU
+ *  texture. The texture is allocated once and updated in place whenever
+ *  the analyzer publishes a new frame, instead of going through the image
+ *  provider and a fresh texture on every tick.
+ *
+ *  The item is also a texture provider, so it can be bound straight to a
+ *  ShaderEffect sampler. The AudioFeatures of the same frame are exposed as
+ *  properties, bands and beat pack them for a ShaderEffect uniform.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef AUDIOTEXTUREITEM_H
+#define AUDIOTEXTUREITEM_H
+
+#include <QImage>
+#include <QQuickItem>
+#include <QSGTexture>
+#include <QSGTextureProvider>
+#include <QVector4D>
+#include <QtQml/qqmlregistration.h>
+
+#include "AudioFeatures.h"
+#include "Komplex_global.h"
+
+class QRhiTexture;
+
+/**!
+ * @brief AudioTexture
+ * Scene graph texture that keeps one QRhiTexture alive and re-uploads the
+ * audio frame into it when it changes. Lives on the render thread.
+ */
+class AudioTexture : public QSGTexture
+{
+    Q_OBJECT
+
+public:
+    AudioTexture();
+    ~AudioTexture();
+
+    qint64 comparisonKey() const override;
+    QRhiTexture *rhiTexture() const override;
+    QSize textureSize() const override;
+    bool hasAlphaChannel() const override;
+    bool hasMipmaps() const override;
+
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates) override;
+
+    /**!
+     * @brief updateFrame
+     * Copies the newest AudioModel frame and queues it for upload. Called
+     * during the scene graph sync, the upload itself happens in
+     * commitTextureOperations().
+     *
+     * @return sequence number of the copied frame
+     */
+    quint64 updateFrame();
+
+private:
+    QRhiTexture *m_texture = nullptr;
+    QImage m_frame; // reused for every frame, only reallocated if the size changes
+    bool m_dirty = false;
+};
+
+class AudioTextureProvider : public QSGTextureProvider
+{
+    Q_OBJECT
+
+public:
+    QSGTexture *texture() const override { return m_texture; }
+    void setTexture(AudioTexture *texture) { m_texture = texture; }
+
+    void notifyTextureChanged() { Q_EMIT textureChanged(); }
+
+private:
+    AudioTexture *m_texture = nullptr;
+};
+
+class KOMPLEX_EXPORT AudioTextureItem : public QQuickItem
+{
+    Q_OBJECT
+    QML_NAMED_ELEMENT(AudioTexture)
+
+    // while false the item does not need audio, and once every item agrees the capture stream is suspended
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+
+    // asks for AudioModel::sharedAnalysis, read once when the item starts capturing
+    Q_PROPERTY(bool sharedAnalysis READ sharedAnalysis WRITE setSharedAnalysis NOTIFY sharedAnalysisChanged)
+
+    // features of the newest frame, see AudioFeatures. updated at most once
+    // per rendered frame
+    Q_PROPERTY(qreal subBass READ subBass NOTIFY featuresChanged)
+    Q_PROPERTY(qreal bass READ bass NOTIFY featuresChanged)
+    Q_PROPERTY(qreal mid READ mid NOTIFY featuresChanged)
+    Q_PROPERTY(qreal treble READ treble NOTIFY featuresChanged)
+    Q_PROPERTY(qreal flux READ flux NOTIFY featuresChanged)
+    Q_PROPERTY(bool onset READ onset NOTIFY featuresChanged)
+    Q_PROPERTY(qreal bpm READ bpm NOTIFY featuresChanged)
+    Q_PROPERTY(qreal beatPhase READ beatPhase NOTIFY featuresChanged)
+    Q_PROPERTY(qreal loudness READ loudness NOTIFY featuresChanged)
+
+    // subBass, bass, mid, treble
+    Q_PROPERTY(QVector4D bands READ bands NOTIFY featuresChanged)
+
+    // flux, beatPhase, bpm, loudness
+    Q_PROPERTY(QVector4D beat READ beat NOTIFY featuresChanged)
+
+public:
+    explicit AudioTextureItem(QQuickItem *parent = nullptr);
+    ~AudioTextureItem();
+
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+
+    bool sharedAnalysis() const { return m_sharedAnalysis; }
+    void setSharedAnalysis(bool shared);
+
+    qreal subBass() const { return m_features.subBass; }
+    qreal bass() const { return m_features.bass; }
+    qreal mid() const { return m_features.mid; }
+    qreal treble() const { return m_features.treble; }
+    qreal flux() const { return m_features.flux; }
+    bool onset() const { return m_features.onset > 0.0f; }
+    qreal bpm() const { return m_features.bpm; }
+    qreal beatPhase() const { return m_features.beatPhase; }
+    qreal loudness() const { return m_features.loudness; }
+
+    QVector4D bands() const { return QVector4D(m_features.subBass, m_features.bass, m_features.mid, m_features.treble); }
+    QVector4D beat() const { return QVector4D(m_features.flux, m_features.beatPhase, m_features.bpm, m_features.loudness); }
+
+    bool isTextureProvider() const override { return true; }
+    QSGTextureProvider *textureProvider() const override;
+
+Q_SIGNALS:
+    void activeChanged();
+    void sharedAnalysisChanged();
+    void featuresChanged();
+
+protected:
+    void componentComplete() override;
+    QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *data) override;
+    void updatePolish() override;
+    void releaseResources() override;
+
+private:
+    void ensureTexture() const;
+    void frameReady();
+
+    // render thread objects, created lazily by whichever of updatePaintNode()
+    // or textureProvider() runs first
+    mutable AudioTexture *m_texture = nullptr;
+    mutable AudioTextureProvider *m_provider = nullptr;
+
+    quint64 m_frameSequence = 0; // sequence of the last frame handed to the texture
+    quint64 m_featuresSequence = 0; // sequence of the frame m_features was read from
+    bool m_capturing = false;
+    bool m_active = true;
+    bool m_sharedAnalysis = false;
+    AudioFeatures::Values m_features;
+};
+
+#endif // AUDIOTEXTUREITEM_H
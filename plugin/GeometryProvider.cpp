@@ -1,153 +1,1174 @@
 #include "GeometryProvider.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
+#include "ParallelFor.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QQuaternion>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtEndian>
+#include <QtMath>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include <unistd.h>
+
+namespace
+{
+// layout of a .kmesh file. followed by the size of the index data of every
+// level as a quint64, the files the mesh depends on, then the vertex data and
+// the index data of the levels. written in host byte order, the magic reads
+// differently on a foreign one
+struct CacheHeader
+{
+    char magic[4];
+    quint32 version;
+    char key[20];
+    quint32 flags;
+    quint32 stride;
+    float min[3];
+    float max[3];
+    quint64 vertexBytes;
+    quint32 lods;
+    quint32 dependencies;
+};
+
+static_assert(sizeof(CacheHeader) == 80);
+
+// a file the mesh was built from besides the source, followed by its path
+// as pathBytes of UTF-8
+struct CacheDependency
+{
+    qint64 modified;
+    qint64 size;
+    quint32 pathBytes;
+    quint32 reserved;
+};
+
+static_assert(sizeof(CacheDependency) == 24);
+
+constexpr char CacheMagic[4] = { 'K', 'M', 'S', 'H' };
+
+// open addressing over indices into some array of keys, kept at most half
+// full. the hash of every entry is stored next to it, so the table can grow
+// without touching the keys and most probes never compare them at all
+class WeldTable
+{
+public:
+    explicit WeldTable(qsizetype count)
+    {
+        allocate(qsizetype(std::bit_ceil(quint64(std::max<qsizetype>(count, 1)) * 2)));
+    }
+
+    // index of an equal key already in the table, or candidate once stored
+    template<typename Equal>
+    qint32 insert(quint32 hash, qint32 candidate, Equal equal)
+    {
+        if((m_used + 1) * 2 > m_slots.size())
+            grow();
+
+        quint32 slot = hash & m_mask;
+
+        while(m_slots[slot] >= 0)
+        {
+            if(m_hashes[slot] == hash && equal(m_slots[slot]))
+                return m_slots[slot];
+
+            slot = (slot + 1) & m_mask;
+        }
+
+        m_slots[slot] = candidate;
+        m_hashes[slot] = hash;
+        ++m_used;
+
+        return candidate;
+    }
+
+private:
+    void allocate(qsizetype size)
+    {
+        m_slots = QVector<qint32>(size, -1);
+        m_hashes = QVector<quint32>(size);
+        m_mask = quint32(size - 1);
+    }
+
+    void grow()
+    {
+        const QVector<qint32> slots = std::move(m_slots);
+        const QVector<quint32> hashes = std::move(m_hashes);
+
+        allocate(slots.size() * 2);
+
+        for(qsizetype i = 0; i < slots.size(); ++i)
+        {
+            if(slots[i] < 0)
+                continue;
+
+            quint32 slot = hashes[i] & m_mask;
+
+            while(m_slots[slot] >= 0)
+                slot = (slot + 1) & m_mask;
+
+            m_slots[slot] = slots[i];
+            m_hashes[slot] = hashes[i];
+        }
+    }
+
+    QVector<qint32> m_slots;
+    QVector<quint32> m_hashes;
+    quint32 m_mask = 0;
+    qsizetype m_used = 0;
+};
+
+// index data in the width the attribute declares
+template<typename Indices>
+QByteArray indexBuffer(const Indices &indices, bool wide)
+{
+    QByteArray data(indices.size() * (wide ? sizeof(quint32) : sizeof(quint16)), Qt::Uninitialized);
+
+    if(wide)
+        std::copy(indices.cbegin(), indices.cend(), reinterpret_cast<quint32*>(data.data()));
+    else
+        std::transform(indices.cbegin(), indices.cend(), reinterpret_cast<quint16*>(data.data()), [](quint32 index) { return quint16(index); });
+
+    return data;
+}
+
+// FNV-1a over the bits of the values, -0 is folded into 0 first so both
+// land in the same slot
+inline quint32 hashFloats(float *values, int count)
+{
+    quint32 hash = 2166136261u;
+
+    for(int i = 0; i < count; ++i)
+    {
+        values[i] += 0.0f;
+        hash = (hash ^ std::bit_cast<quint32>(values[i])) * 16777619u;
+    }
+
+    return hash;
+}
+
+// resident size of the process right now, in bytes
+qint64 residentMemory()
+{
+    // pages, the second field of statm
+    QFile statm(QStringLiteral("/proc/self/statm"));
+
+    if(!statm.open(QIODevice::ReadOnly))
+        return 0;
+
+    const QList<QByteArray> fields = statm.readLine().split(' ');
+
+    if(fields.size() < 2)
+        return 0;
+
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+// raises peak to how far the resident size has grown past base. taken at
+// the points a load holds the most, whatever else the process does in the
+// meantime counts towards it as well
+void sampleResidentMemory(qint64 base, qint64 &peak)
+{
+    peak = std::max(peak, residentMemory() - base);
+}
+
+// glTF constants, GLB chunk types read as little endian words
+constexpr quint32 GlbMagic = 0x46546C67;
+constexpr quint32 GlbJsonChunk = 0x4E4F534A;
+constexpr quint32 GlbBinaryChunk = 0x004E4942;
+constexpr int GltfTriangles = 4;
+constexpr qint64 GltfMaximumStride = 252;
+
+enum GltfComponentType
+{
+    GltfByte = 5120,
+    GltfUnsignedByte = 5121,
+    GltfShort = 5122,
+    GltfUnsignedShort = 5123,
+    GltfUnsignedInt = 5125,
+    GltfFloat = 5126
+};
+
+// buffers other than the binary chunk or a data uri are files relative to
+// the model
+QString gltfBufferPath(const QDir &directory, const QString &uri)
+{
+    return directory.filePath(QUrl::fromPercentEncoding(uri.toUtf8()));
+}
+
+struct GltfBuffer
+{
+    const uchar *data = nullptr;
+    qint64 size = 0;
+};
+
+// a typed view into one of the buffers, read in place
+struct GltfAccessor
+{
+    const uchar *data = nullptr;
+    qsizetype count = 0;
+    qint64 stride = 0;
+    int componentType = 0;
+    int componentSize = 0;
+    int components = 0;
+    bool normalized = false;
+
+    float component(qsizetype element, int i) const
+    {
+        const uchar *p = data + element * stride + i * componentSize;
+
+        switch(componentType)
+        {
+        case GltfFloat:
+            return qFromLittleEndian<float>(p);
+        case GltfByte:
+            return normalized ? std::max(qint8(*p) / 127.0f, -1.0f) : float(qint8(*p));
+        case GltfUnsignedByte:
+            return normalized ? *p / 255.0f : float(*p);
+        case GltfShort:
+            return normalized ? std::max(qFromLittleEndian<qint16>(p) / 32767.0f, -1.0f) : float(qFromLittleEndian<qint16>(p));
+        case GltfUnsignedShort:
+            return normalized ? qFromLittleEndian<quint16>(p) / 65535.0f : float(qFromLittleEndian<quint16>(p));
+        case GltfUnsignedInt:
+            return float(qFromLittleEndian<quint32>(p));
+        }
+
+        return 0.0f;
+    }
+
+    quint32 index(qsizetype element) const
+    {
+        const uchar *p = data + element * stride;
+
+        switch(componentType)
+        {
+        case GltfUnsignedByte:
+            return *p;
+        case GltfUnsignedShort:
+            return qFromLittleEndian<quint16>(p);
+        default:
+            return qFromLittleEndian<quint32>(p);
+        }
+    }
+};
+
+int gltfComponentSize(int componentType)
+{
+    switch(componentType)
+    {
+    case GltfByte:
+    case GltfUnsignedByte:
+        return 1;
+    case GltfShort:
+    case GltfUnsignedShort:
+        return 2;
+    case GltfUnsignedInt:
+    case GltfFloat:
+        return 4;
+    }
+
+    return 0;
+}
+
+int gltfComponents(const QString &type)
+{
+    if(type == QLatin1String("SCALAR"))
+        return 1;
+
+    if(type == QLatin1String("VEC2"))
+        return 2;
+
+    if(type == QLatin1String("VEC3"))
+        return 3;
+
+    if(type == QLatin1String("VEC4"))
+        return 4;
+
+    return 0;
+}
+
+// resolves an accessor down to its bytes. false for anything that is not
+// read: sparse accessors, accessors without a buffer view and views that
+// reach past their buffer
+bool gltfAccessor(const QJsonObject &root, const QVector<GltfBuffer> &buffers, int index, GltfAccessor &accessor)
+{
+    const QJsonObject object = root.value(QLatin1String("accessors")).toArray().at(index).toObject();
+    const int viewIndex = object.value(QLatin1String("bufferView")).toInt(-1);
+
+    if(object.isEmpty() || object.contains(QLatin1String("sparse")) || viewIndex < 0)
+        return false;
+
+    const QJsonObject view = root.value(QLatin1String("bufferViews")).toArray().at(viewIndex).toObject();
+    const int bufferIndex = view.value(QLatin1String("buffer")).toInt(-1);
+
+    if(bufferIndex < 0 || bufferIndex >= buffers.size())
+        return false;
+
+    accessor.componentType = object.value(QLatin1String("componentType")).toInt();
+    accessor.componentSize = gltfComponentSize(accessor.componentType);
+    accessor.components = gltfComponents(object.value(QLatin1String("type")).toString());
+    accessor.count = object.value(QLatin1String("count")).toInteger();
+    accessor.normalized = object.value(QLatin1String("normalized")).toBool();
+
+    const qint64 elementSize = qint64(accessor.componentSize) * accessor.components;
+    const qint64 viewOffset = view.value(QLatin1String("byteOffset")).toInteger();
+    const qint64 viewLength = view.value(QLatin1String("byteLength")).toInteger();
+    const qint64 offset = object.value(QLatin1String("byteOffset")).toInteger();
+
+    // views shared by several attributes interleave them with a stride
+    accessor.stride = view.value(QLatin1String("byteStride")).toInteger(elementSize);
+
+    const GltfBuffer &buffer = buffers[bufferIndex];
+
+    // every value comes from the file, the bounds are checked by subtracting
+    // and dividing so a huge count or offset cannot overflow past them
+    if(!buffer.data || elementSize == 0 || accessor.count <= 0
+        || accessor.stride < elementSize || accessor.stride > GltfMaximumStride
+        || viewOffset < 0 || viewLength < 0 || offset < 0
+        || viewOffset > buffer.size || viewLength > buffer.size - viewOffset
+        || offset > viewLength - elementSize
+        || accessor.count - 1 > (viewLength - offset - elementSize) / accessor.stride)
+        return false;
+
+    accessor.data = buffer.data + viewOffset + offset;
+
+    return true;
+}
+
+// local transform of a node, either a column major matrix or a translation,
+// rotation and scale
+QMatrix4x4 gltfNodeTransform(const QJsonObject &node)
+{
+    const QJsonArray matrix = node.value(QLatin1String("matrix")).toArray();
+
+    if(matrix.size() == 16)
+    {
+        float values[16];
+
+        for(int i = 0; i < 16; ++i)
+            values[i] = float(matrix.at(i).toDouble());
+
+        // QMatrix4x4 reads row major
+        return QMatrix4x4(values).transposed();
+    }
+
+    const QJsonArray translation = node.value(QLatin1String("translation")).toArray();
+    const QJsonArray rotation = node.value(QLatin1String("rotation")).toArray();
+    const QJsonArray scale = node.value(QLatin1String("scale")).toArray();
+    QMatrix4x4 transform;
+
+    if(translation.size() == 3)
+        transform.translate(translation.at(0).toDouble(), translation.at(1).toDouble(), translation.at(2).toDouble());
+
+    // stored as x, y, z, w
+    if(rotation.size() == 4)
+        transform.rotate(QQuaternion(rotation.at(3).toDouble(), rotation.at(0).toDouble(), rotation.at(1).toDouble(), rotation.at(2).toDouble()));
+
+    if(scale.size() == 3)
+        transform.scale(scale.at(0).toDouble(), scale.at(1).toDouble(), scale.at(2).toDouble());
+
+    return transform;
+}
+
+// a primitive and where it ends up in the scene
+struct GltfDraw
+{
+    QJsonObject primitive;
+    QMatrix4x4 transform;
+};
+
+void collectGltfDraws(const QJsonObject &root, int nodeIndex, const QMatrix4x4 &parent, int depth, QVector<GltfDraw> &draws)
+{
+    const QJsonArray nodes = root.value(QLatin1String("nodes")).toArray();
+
+    // node graphs are trees, the depth only stops a broken file that loops
+    if(nodeIndex < 0 || nodeIndex >= nodes.size() || depth > nodes.size())
+        return;
+
+    const QJsonObject node = nodes.at(nodeIndex).toObject();
+    const QMatrix4x4 transform = parent * gltfNodeTransform(node);
+    const int meshIndex = node.value(QLatin1String("mesh")).toInt(-1);
+
+    if(meshIndex >= 0)
+    {
+        const QJsonObject mesh = root.value(QLatin1String("meshes")).toArray().at(meshIndex).toObject();
+
+        for(const QJsonValue &primitive : mesh.value(QLatin1String("primitives")).toArray())
+            draws << GltfDraw { primitive.toObject(), transform };
+    }
+
+    for(const QJsonValue &child : node.value(QLatin1String("children")).toArray())
+        collectGltfDraws(root, child.toInt(-1), transform, depth + 1, draws);
+}
+
+enum CacheFlag : quint32
+{
+    CacheHasUv = 1,
+    CacheWideIndices = 2
+};
+}
+
 GeometryProvider::GeometryProvider(QQuick3DObject *parent) : QQuick3DGeometry{parent}
 {
 
-}
+}
+
+void GeometryProvider::setHasNormals(bool hasNormals)
+{
+    if(m_hasNormals != hasNormals)
+    {
+        m_hasNormals = hasNormals;
+        Q_EMIT hasNormalsChanged();
+    }
+}
+
+void GeometryProvider::setHasUv(bool hasUv)
+{
+    if(m_hasUV != hasUv)
+    {
+        m_hasUV = hasUv;
+        Q_EMIT hasUvChanged();
+    }
+}
+
+void GeometryProvider::setUVAdjust(qreal adjust)
+{
+    if(m_options.uvAdjust != adjust)
+    {
+        m_options.uvAdjust = adjust;
+        Q_EMIT uvAdjustChanged();
+
+        scheduleReload();
+    }
+}
+
+void GeometryProvider::setCreaseAngle(qreal angle)
+{
+    angle = std::clamp<qreal>(angle, 0.0, 180.0);
+
+    if(m_options.creaseAngle != angle)
+    {
+        m_options.creaseAngle = angle;
+        Q_EMIT creaseAngleChanged();
+
+        scheduleReload();
+    }
+}
+
+void GeometryProvider::setAngleWeightedNormals(bool enable)
+{
+    if(m_options.angleWeighted != enable)
+    {
+        m_options.angleWeighted = enable;
+        Q_EMIT angleWeightedNormalsChanged();
+
+        scheduleReload();
+    }
+}
+
+void GeometryProvider::setBuildLods(bool enable)
+{
+    if(m_options.buildLods != enable)
+    {
+        m_options.buildLods = enable;
+        Q_EMIT buildLodsChanged();
+
+        scheduleReload();
+    }
+}
+
+void GeometryProvider::setLodBias(int bias)
+{
+    bias = std::max(bias, 0);
+
+    if(m_lodBias != bias)
+    {
+        m_lodBias = bias;
+        Q_EMIT lodBiasChanged();
+
+        applyLod();
+    }
+}
+
+void GeometryProvider::setMaxTriangles(int triangles)
+{
+    triangles = std::max(triangles, 0);
+
+    if(m_maxTriangles != triangles)
+    {
+        m_maxTriangles = triangles;
+        Q_EMIT maxTrianglesChanged();
+
+        applyLod();
+    }
+}
+
+void GeometryProvider::setState(State state)
+{
+    if(m_state != state)
+    {
+        m_state = state;
+        Q_EMIT stateChanged();
+    }
+}
+
+void GeometryProvider::setProgress(qreal progress)
+{
+    if(m_progress != progress)
+    {
+        m_progress = progress;
+        Q_EMIT progressChanged();
+    }
+}
+
+void GeometryProvider::setSource(const QString &source)
+{
+    if(m_source == source)
+        return;
+
+    m_source = source;
+    Q_EMIT sourceChanged();
+
+    scheduleReload();
+}
+
+void GeometryProvider::componentComplete()
+{
+    QQuick3DGeometry::componentComplete();
+
+    // every property QML set so far goes into the first load
+    m_componentComplete = true;
+    reload();
+}
+
+void GeometryProvider::scheduleReload()
+{
+    // whatever is still loading with the old settings is dropped when it arrives
+    ++m_generation;
+
+    // changes made in the same event loop pass end up in one load, and
+    // before componentComplete() there is nothing to load yet
+    if(m_reloadPending || !m_componentComplete)
+        return;
+
+    m_reloadPending = true;
+    QMetaObject::invokeMethod(this, &GeometryProvider::reload, Qt::QueuedConnection);
+}
+
+void GeometryProvider::reload()
+{
+    m_reloadPending = false;
+
+    // anything still loading for the previous source is dropped when it arrives
+    const quint64 generation = ++m_generation;
+
+    if(m_source.isEmpty())
+    {
+        clear();
+        update();
+
+        if(!m_lods.isEmpty())
+        {
+            m_lods.clear();
+            Q_EMIT lodCountChanged();
+        }
+
+        setProgress(0.0);
+        setState(Idle);
+        return;
+    }
+
+    // QML hands over resolved urls
+    const QUrl url(m_source);
+    QString path = m_source;
+
+    if(url.isLocalFile())
+        path = url.toLocalFile();
+    else if(url.scheme() == QLatin1String("qrc"))
+        path = QLatin1Char(':') + url.path();
+
+    setProgress(0.0);
+    setState(Loading);
+
+    // results come back through the application object, which outlives any
+    // load. the guard is only read on the gui thread, where the provider is
+    // also destroyed
+    QPointer<GeometryProvider> guard(this);
+    const Options options = m_options;
+
+    QThreadPool::globalInstance()->start([guard, generation, path, options]() {
+        auto report = [guard, generation](qreal progress) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, generation, progress]() {
+                if(guard && guard->m_generation == generation)
+                    guard->setProgress(progress);
+            }, Qt::QueuedConnection);
+        };
+
+        std::shared_ptr<Mesh> mesh = load(path, options, report);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, generation, mesh]() {
+            if(guard && guard->m_generation == generation)
+                guard->apply(*mesh);
+        }, Qt::QueuedConnection);
+    });
+}
+
+std::shared_ptr<GeometryProvider::Mesh> GeometryProvider::load(const QString &path, const Options &options, const Progress &progress)
+{
+    auto mesh = std::make_shared<Mesh>();
+
+    QFile file(path);
+    QFileInfo fileInfo(file);
+
+    if(!fileInfo.exists())
+    {
+        mesh->error = QLatin1String("File %1 does not exist").arg(fileInfo.absoluteFilePath());
+        return mesh;
+    }
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        mesh->error = QLatin1String("Could not open %1").arg(fileInfo.absoluteFilePath());
+        return mesh;
+    }
+
+    mesh->residentBase = residentMemory();
+
+    // a cache hit skips parsing and recomputeAll entirely
+    const QByteArray key = cacheKey(fileInfo, options);
+    const QString cache = cachePath(fileInfo, options);
+
+    if(loadCache(cache, key, *mesh))
+    {
+        sampleResidentMemory(mesh->residentBase, mesh->peakMemory);
+        progress(1.0);
+        return mesh;
+    }
+
+    progress(0.1);
+
+    bool loaded = false;
+    const QString suffix = fileInfo.suffix().toLower();
+
+    if(suffix == QLatin1String("obj"))
+        loaded = loadObj(file, *mesh);
+
+    else if(suffix == QLatin1String("stl"))
+        loaded = loadStl(file, *mesh);
+
+    else if(suffix == QLatin1String("gltf") || suffix == QLatin1String("glb"))
+        loaded = loadGltf(file, *mesh);
+
+    else
+        mesh->error = QLatin1String("%1 is not an OBJ, STL or glTF file").arg(fileInfo.absoluteFilePath());
+
+    if(!loaded)
+        return mesh;
+
+    sampleResidentMemory(mesh->residentBase, mesh->peakMemory);
+
+    // parsing is by far the longest part of a load
+    progress(0.8);
+
+    recomputeAll(*mesh, options);
+
+    // only the interleaved and index buffers are uploaded, the parsed arrays
+    // would otherwise live on until the gui thread is done with the mesh
+    mesh->vertices = {};
+    mesh->normals = {};
+    mesh->uv = {};
+    mesh->indices = {};
+
+    if(options.buildLods)
+    {
+        progress(0.9);
+        simplify(*mesh);
+    }
+
+    saveCache(cache, key, *mesh);
+
+    progress(1.0);
+
+    return mesh;
+}
+
+QByteArray GeometryProvider::cacheKey(const QFileInfo &fileInfo, const Options &options)
+{
+    // anything that changes the built buffers has to be part of the key. it
+    // is kept in the header, a cache file with another key is rebuilt
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    hash.addData(fileInfo.canonicalFilePath().toUtf8());
+    hash.addData(QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+    hash.addData(QByteArray::number(fileInfo.size()));
+    hash.addData(QByteArray::number(options.uvAdjust));
+    hash.addData(QByteArray::number(options.creaseAngle));
+    hash.addData(QByteArray::number(options.angleWeighted));
+    hash.addData(QByteArray::number(options.buildLods));
+    hash.addData(QByteArray::number(CacheVersion));
+
+    return hash.result();
+}
+
+QString GeometryProvider::cachePath(const QFileInfo &fileInfo, const Options &options)
+{
+    // named after the source and the options, so an edited file replaces its
+    // cache file instead of leaving the old one behind, while providers
+    // loading the same model with other options keep a file each
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    hash.addData(fileInfo.canonicalFilePath().toUtf8());
+    hash.addData(QByteArray::number(options.uvAdjust));
+    hash.addData(QByteArray::number(options.creaseAngle));
+    hash.addData(QByteArray::number(options.angleWeighted));
+    hash.addData(QByteArray::number(options.buildLods));
+
+    const QByteArray name = hash.result().toHex();
+
+    return QStringLiteral("%1/.local/share/komplex/cache/%2.kmesh").arg(QStandardPaths::writableLocation(QStandardPaths::HomeLocation), QString::fromLatin1(name));
+}
+
+void GeometryProvider::pruneCache(const QString &directory)
+{
+    // newest first, loadCache() touches the files it reads
+    const QFileInfoList files = QDir(directory).entryInfoList({QStringLiteral("*.kmesh")}, QDir::Files, QDir::Time);
+    qint64 total = 0;
+
+    // the newest file stays even on its own over the limit, it was just written
+    for(qsizetype i = 0; i < files.size(); ++i)
+    {
+        total += files[i].size();
+
+        if(i > 0 && total > CacheSizeLimit)
+            QFile::remove(files[i].absoluteFilePath());
+    }
+}
+
+bool GeometryProvider::loadCache(const QString &path, const QByteArray &key, Mesh &mesh)
+{
+    QFile file(path);
+
+    if(!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(CacheHeader)))
+        return false;
+
+    // one mapping, the buffers are copied out of it as they are
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+
+    if(!data)
+        return false;
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    bool valid = std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) == 0
+        && header.version == CacheVersion
+        && key.size() == sizeof(header.key)
+        && std::memcmp(header.key, key.constData(), sizeof(header.key)) == 0
+        && header.stride > 0
+        && header.vertexBytes % header.stride == 0
+        && header.lods >= 1 && header.lods <= MaximumLods
+        && size >= qint64(sizeof(CacheHeader) + header.lods * sizeof(quint64));
+
+    if(valid)
+    {
+        const char *end = reinterpret_cast<const char*>(data) + size;
+        const char *sizes = reinterpret_cast<const char*>(data) + sizeof(CacheHeader);
+        const char *cursor = sizes + header.lods * sizeof(quint64);
+        QVector<quint64> lodBytes(header.lods);
+
+        std::memcpy(lodBytes.data(), sizes, header.lods * sizeof(quint64));
+
+        // stale once any of the files the mesh was built from differs from
+        // when it was written. only their stats are compared, the source
+        // itself is not parsed again
+        for(quint32 i = 0; valid && i < header.dependencies; ++i)
+        {
+            CacheDependency dependency;
+
+            valid = end - cursor >= qint64(sizeof(dependency));
+
+            if(!valid)
+                break;
+
+            std::memcpy(&dependency, cursor, sizeof(dependency));
+            cursor += sizeof(dependency);
+
+            valid = end - cursor >= qint64(dependency.pathBytes);
+
+            if(!valid)
+                break;
+
+            const QFileInfo fileInfo(QString::fromUtf8(cursor, dependency.pathBytes));
+            cursor += dependency.pathBytes;
+
+            valid = fileInfo.exists()
+                && fileInfo.lastModified().toMSecsSinceEpoch() == dependency.modified
+                && fileInfo.size() == dependency.size;
+        }
+
+        // the buffers fill the rest of the file exactly. taken off one at a
+        // time, so corrupt sizes cannot overflow a sum of them
+        quint64 remaining = quint64(end - cursor);
+
+        valid = valid && header.vertexBytes <= remaining;
+
+        if(valid)
+            remaining -= header.vertexBytes;
+
+        for(quint64 bytes : lodBytes)
+        {
+            valid = valid && bytes <= remaining;
+
+            if(valid)
+                remaining -= bytes;
+        }
+
+        valid = valid && remaining == 0;
+
+        if(valid)
+        {
+            const char *vertices = cursor;
+
+            mesh.vertexData = QByteArray(vertices, header.vertexBytes);
+
+            const char *indices = vertices + header.vertexBytes;
+
+            for(quint64 bytes : lodBytes)
+            {
+                mesh.lods << QByteArray(indices, bytes);
+                indices += bytes;
+            }
+
+            mesh.stride = header.stride;
+            mesh.hasNormals = true;
+            mesh.hasUv = header.flags & CacheHasUv;
+            mesh.wideIndices = header.flags & CacheWideIndices;
+            mesh.min = QVector3D(header.min[0], header.min[1], header.min[2]);
+            mesh.max = QVector3D(header.max[0], header.max[1], header.max[2]);
+
+            // recently used files are the last ones pruneCache() removes
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+    }
+
+    file.unmap(const_cast<uchar*>(data));
+
+    return valid;
+}
+
+void GeometryProvider::saveCache(const QString &path, const QByteArray &key, const Mesh &mesh)
+{
+    if(!QDir().mkpath(QFileInfo(path).absolutePath()))
+        return;
+
+    CacheHeader header {};
+
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    std::memcpy(header.key, key.constData(), std::min<qsizetype>(key.size(), sizeof(header.key)));
+
+    header.version = CacheVersion;
+    header.flags = (mesh.hasUv ? CacheHasUv : 0) | (mesh.wideIndices ? CacheWideIndices : 0);
+    header.stride = mesh.stride;
+    header.vertexBytes = mesh.vertexData.size();
+    header.lods = mesh.lods.size();
+    header.dependencies = mesh.dependencies.size();
+
+    for(int i = 0; i < 3; ++i)
+    {
+        header.min[i] = mesh.min[i];
+        header.max[i] = mesh.max[i];
+    }
+
+    // written aside and renamed, a reader never sees half a file
+    QSaveFile file(path);
+
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for(const QByteArray &lod : mesh.lods)
+    {
+        const quint64 bytes = lod.size();
+        file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+    }
+
+    for(const Mesh::Dependency &dependency : mesh.dependencies)
+    {
+        const QByteArray path = dependency.path.toUtf8();
+        CacheDependency record {};
+
+        record.modified = dependency.modified;
+        record.size = dependency.size;
+        record.pathBytes = path.size();
+
+        file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        file.write(path);
+    }
+
+    file.write(mesh.vertexData);
+
+    for(const QByteArray &lod : mesh.lods)
+        file.write(lod);
+
+    if(!file.commit())
+    {
+        qWarning() << QLatin1String("Could not write the mesh cache %1").arg(path);
+        return;
+    }
+
+    pruneCache(QFileInfo(path).absolutePath());
+}
+
+void GeometryProvider::apply(const Mesh &mesh)
+{
+    if(!mesh.error.isEmpty())
+    {
+        qWarning() << mesh.error;
+
+        setState(Error);
+        return;
+    }
+
+    setHasNormals(mesh.hasNormals);
+    setHasUv(mesh.hasUv);
+
+    m_min = mesh.min;
+    m_max = mesh.max;
+    m_size = m_max - m_min;
+    m_center = (m_min + m_max) / 2;
+
+    // attributes of a previous source would pile up otherwise
+    clear();
+
+    setBounds(m_min, m_max);
+    setVertexData(mesh.vertexData);
+    setStride(mesh.stride);
+
+    setPrimitiveType(QQuick3DGeometry::PrimitiveType::Triangles);
+
+    addAttribute(QQuick3DGeometry::Attribute::PositionSemantic,
+                 0,
+                 QQuick3DGeometry::Attribute::F32Type);
+
+    if (m_hasNormals) {
+        addAttribute(QQuick3DGeometry::Attribute::NormalSemantic,
+                     3 * sizeof(float),
+                     QQuick3DGeometry::Attribute::F32Type);
+    }
+
+    if (m_hasUV) {
+        addAttribute(QQuick3DGeometry::Attribute::TexCoordSemantic,
+                     m_hasNormals ? 6 * sizeof(float) : 3 * sizeof(float),
+                     QQuick3DGeometry::Attribute::F32Type);
+    }
+
+    addAttribute(QQuick3DGeometry::Attribute::IndexSemantic,
+                 0,
+                 mesh.wideIndices ? QQuick3DGeometry::Attribute::U32Type : QQuick3DGeometry::Attribute::U16Type);
+
+    // the index data of every level is kept, switching is then only a matter
+    // of handing over another buffer
+    const bool countChanged = m_lods.size() != mesh.lods.size();
+
+    m_lods = mesh.lods;
+    m_wideIndices = mesh.wideIndices;
+    m_lod = -1;
+
+    applyLod();
+
+    if(countChanged)
+        Q_EMIT lodCountChanged();
+
+    if(m_peakMemory != mesh.peakMemory)
+    {
+        m_peakMemory = mesh.peakMemory;
+        Q_EMIT peakMemoryChanged();
+    }
+
+    setProgress(1.0);
+    setState(Loaded);
+}
+
+void GeometryProvider::applyLod()
+{
+    if(m_lods.isEmpty())
+        return;
+
+    const qsizetype indexSize = m_wideIndices ? sizeof(quint32) : sizeof(quint16);
+    int lod = std::min<int>(m_lodBias, m_lods.size() - 1);
+
+    while(m_maxTriangles > 0 && lod + 1 < m_lods.size() && m_lods[lod].size() / indexSize / 3 > m_maxTriangles)
+        ++lod;
+
+    if(lod == m_lod)
+        return;
+
+    m_lod = lod;
+
+    setIndexData(m_lods[lod]);
+    update();
+}
+
+bool GeometryProvider::loadObj(QFile &file, Mesh &mesh)
+{
+    const qint64 size = file.size();
+    QByteArray contents;
+    uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    const char *data = reinterpret_cast<const char*>(mapped);
+
+    if(!data)
+    {
+        contents = file.readAll();
+        data = contents.constData();
+    }
+
+    ObjParser parser;
+    const bool parsed = parser.parse(data, mapped ? size : contents.size());
+
+    if(mapped)
+        file.unmap(mapped);
+
+    if(parser.skippedFaces() > 0)
+        qWarning() << QLatin1String("Skipped %1 faces with invalid indices in %2").arg(QString::number(parser.skippedFaces()), file.fileName());
+
+    if(!parsed)
+    {
+        mesh.error = QLatin1String("%1 does not contain any faces").arg(file.fileName());
+        return false;
+    }
+
+    const QVector<ObjParser::Corner> &corners = parser.corners();
+    const bool hasUv = !parser.texcoords().isEmpty();
+
+    // file normals are only used if every corner has one, otherwise they are
+    // all rebuilt from the faces
+    const bool hasNormals = !parser.normals().isEmpty()
+        && std::none_of(corners.cbegin(), corners.cend(), [](const ObjParser::Corner &corner) { return corner.normal < 0; });
+
+    mesh.indices.resize(corners.size());
 
-void GeometryProvider::setHasNormals(bool hasNormals)
-{
-    if(m_hasNormals != hasNormals)
+    if(!hasUv && !hasNormals)
     {
-        m_hasNormals = hasNormals;
-        Q_EMIT hasNormalsChanged();
-    }
-}
+        // positions alone, the indices can be used as they are
+        mesh.vertices = parser.positions();
 
-void GeometryProvider::setHasUv(bool hasUv)
-{
-    if(m_hasUV != hasUv)
+        for(qsizetype i = 0; i < corners.size(); ++i)
+            mesh.indices[i] = corners[i].position;
+    }
+    else
     {
-        m_hasUV = hasUv;
-        Q_EMIT hasUvChanged();
+        // one vertex per distinct v/vt/vn combination
+        QHash<ObjParser::Corner, int> vertices;
+        vertices.reserve(parser.positions().size());
+
+        for(qsizetype i = 0; i < corners.size(); ++i)
+        {
+            ObjParser::Corner corner = corners[i];
+
+            if(!hasUv)
+                corner.texcoord = -1;
+
+            if(!hasNormals)
+                corner.normal = -1;
+
+            const int vertex = vertices.value(corner, int(mesh.vertices.size()));
+
+            if(vertex == mesh.vertices.size())
+            {
+                vertices.insert(corner, vertex);
+
+                mesh.vertices << parser.positions().at(corner.position);
+
+                if(hasUv)
+                    mesh.uv << (corner.texcoord >= 0 ? parser.texcoords().at(corner.texcoord) : QVector2D());
+
+                if(hasNormals)
+                    mesh.normals << parser.normals().at(corner.normal);
+            }
+
+            mesh.indices[i] = vertex;
+        }
     }
+
+    mesh.hasUv = hasUv;
+    mesh.hasNormals = hasNormals;
+
+    return true;
 }
 
-void GeometryProvider::setUVAdjust(qreal adjust)
+bool GeometryProvider::loadStl(QFile &file, Mesh &mesh)
 {
-    if(m_uvAdjust != adjust)
+    // binary files are read in place, the records are never copied through
+    // the file device. fall back to a single read if the file cannot be mapped
+    const qint64 size = file.size();
+    QByteArray contents;
+    uchar *mapped = size >= StlHeaderSize ? file.map(0, size) : nullptr;
+    const uchar *data = mapped;
+
+    if(!data && size >= StlHeaderSize)
     {
-        m_uvAdjust = adjust;
-        Q_EMIT uvAdjustChanged();
+        contents = file.readAll();
+
+        if(contents.size() == size)
+            data = reinterpret_cast<const uchar*>(contents.constData());
     }
-}
 
-void GeometryProvider::setSource(QString &source)
-{
-    QFile file(source);
-    QFileInfo fileInfo(file);
+    // plenty of exporters start binary headers with "solid" too, so a size
+    // that matches the triangle count wins over the header text
+    bool binary = false;
 
-    if(!fileInfo.exists())
+    if(data)
     {
-        qWarning() << QLatin1String("File %1 does not exist").arg(fileInfo.absoluteFilePath());
-        return;
+        const qint64 expected = StlHeaderSize + qint64(qFromLittleEndian<quint32>(data + 80)) * StlRecordSize;
+        binary = expected == size || qstrncmp(reinterpret_cast<const char*>(data), "solid", 5) != 0;
     }
 
-    if(fileInfo.suffix() == QLatin1String("obj"))
-        loadObj(file);
-    
-    else if(fileInfo.suffix() == QLatin1String("stl"))
-        loadStl(file);
-}
-
-void GeometryProvider::loadObj(QFile &file)
-{
-    // 1e9 = 1*10^9 = 1,000,000,000
-    QVector3D boundsMin( 1e9, 1e9, 1e9);
-    QVector3D boundsMax(-1e9,-1e9,-1e9);
-    setHasNormals(false);
-    setHasUv(false);
+    if(binary)
+    {
+        const bool loaded = loadBinaryStl(data, size, mesh);
 
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        QString input = in.readLine();
-        // # means comment
-        if (input.isEmpty() || input[0] == QLatin1Char('#'))
-            continue;
+        if(mapped)
+            file.unmap(mapped);
 
-        QTextStream ts(&input);
-        QString id;
-        ts >> id;
-        //---------------  v = List of vertices with (x,y,z[,w]) corrdinates. -----------------
-        if (id == QLatin1String("v")) {
-            QVector3D p;
-            for (int i = 0; i < 3; ++i)
-            {
-                ts >> p[i];
-                boundsMin[i] = qMin(boundsMin[i], p[i]);
-                boundsMax[i] = qMax(boundsMax[i], p[i]);
-            }
-            m_vertices << p;
-
-        //--------------- f = Face definitions -----------------
-        } else if (id == QLatin1String("f") || id == QLatin1String("fo")) {
-            QVarLengthArray<int, 4> p;
-
-            while (!ts.atEnd()) {
-                QString vertex;
-                ts >> vertex;
-                //e.g. vertex / texture
-                // vertex index in correspondence with vertex list.
-                const int vertexIndex = vertex.split(QLatin1Char('/')).value(0).toInt();
-//                qDebug() << "> vertexIndex : " << vertexIndex;
-                if (vertexIndex) {
-                    p.append((vertexIndex > 0) ? (vertexIndex - 1) : (m_vertices.size() + vertexIndex));
-//                    int d = (vertexIndex > 0) ? (vertexIndex - 1) : (m_vertices.size() + vertexIndex);
-//                    qDebug() << "selected index : " << d;
-                }
-            }
+        if(!loaded)
+            return false;
 
-            qDebug() << QLatin1String("p.size(%1) vs. vertexIndices.size(%2)").arg(QString::number(p.size())).arg(QString::number(m_vertexIndices.size()));
-            
-            for (int i = 0; i < p.size(); ++i) {
-                const int edgeA = p[i];
-                const int edgeB = p[(i + 1) % p.size()];
-//                qDebug() << QString("edgeA(%1/%2), edgeB(%3/%4)").arg(QString::number(edgeA), QString::number(i), QString::number(edgeB), QString::number((i + 1) % p.size())) ;
+        mesh.hasNormals = true;
+    }
+    else
+    {
+        if(mapped)
+            file.unmap(mapped);
 
-                if (edgeA < edgeB) {
-                    m_edgeIndices << edgeA << edgeB;                    
-//                    qDebug() << "Added : edgeA : " << edgeA << " / edgeB : " << edgeB ;
-                }
-            }
+        file.seek(0);
 
-            // append vertex / texture-coordinate / normal
-            for (int i = 0; i < 3; ++i)
-                m_vertexIndices << p[i];
+        QTextStream stream(&file);
+        const QString &head = stream.readLine();
 
-            if (p.size() == 4)
-                for (int i = 0; i < 3; ++i)
-                    m_vertexIndices << p[(i + 2) % 4];
+        if(head.left(6) != QLatin1String("solid "))
+        {
+            mesh.error = QLatin1String("%1 is not an STL file").arg(file.fileName());
+            return false;
         }
-    }
 
-    qDebug() << QLatin1String("size(%1), max-x(%2), min-x(%3), max-y(%4), min-y(%5), max-z(%6), min-z(%7)")
-                .arg(QString::number(m_vertices.size()),
-                     QString::number(boundsMax.x()),
-                     QString::number(boundsMin.x()),
-                     QString::number(boundsMax.y()),
-                     QString::number(boundsMin.y()),
-                     QString::number(boundsMax.z()),
-                     QString::number(boundsMin.z()));
-    const QVector3D bounds = boundsMax - boundsMin;
-    const qreal scale = 1 / qMax(bounds.x(), qMax(bounds.y(), bounds.z()));
-    qDebug() << QLatin1String("scale(%1) = 1 / %2")
-                .arg(QString::number(scale), QString::number(qMax(bounds.x(), qMax(bounds.y(), bounds.z()))));
-//    for (int i = 0; i < m_vertices.size(); ++i) {
-//        //the way to place the model by mutiplying the ratio.
-//        float ratio = 0.f;
-//        m_vertices[i] = (m_vertices[i] - (boundsMin + bounds * ratio)) * scale;
-//    }
-
-    m_verticesNew = m_vertices;
-    recomputeAll();
-}
-
-void GeometryProvider::loadStl(QFile &file)
-{    
-    QTextStream stream(&file);
-    const QString &head = stream.readLine();
-    setHasUv(false);
-    if (head.left(6) == QLatin1String("solid ") && head.size() < 80)	// ASCII format
-    {
 //        name = head.right(head.size() - 6).toStdString();
         QString word;
         stream >> word;
@@ -160,181 +1181,649 @@ void GeometryProvider::loadStl(QFile &file)
 
             stream >> word >> word;	// outer loop
             stream >> word;
-            size_t startIndex = m_vertices.size();
+            size_t startIndex = mesh.vertices.size();
             for(; word != QLatin1String("endloop") ; stream >> word)
             {
                 QVector3D v; //vertex x y z
                 stream >> v[0] >> v[1] >> v[2];
-                m_vertices.push_back(v);
+                mesh.vertices.push_back(v);
 //                qDebug() << "==== outer loop ===";
             }
 
-            for(qsizetype i = startIndex + 2 ; i < m_vertices.size() ; ++i)
+            for(qsizetype i = startIndex + 2 ; i < mesh.vertices.size() ; ++i)
             {
-                m_vertexIndices.push_back(startIndex);
-                m_vertexIndices.push_back(i - 1);
-                m_vertexIndices.push_back(i);
-
-                qDebug() << QLatin1String("edgeA(%1), edgeB(%2)").arg(QString::number(startIndex), QString::number(i)) ;
-
-//                if (startIndex < (i-1))
-                    m_edgeIndices << (startIndex) << (i - 1) << i;
+                mesh.indices.push_back(startIndex);
+                mesh.indices.push_back(i - 1);
+                mesh.indices.push_back(i);
             }
             stream >> word;	// endfacet
-            setHasNormals(false);
         }
-    } else {
-        file.setTextModeEnabled(false);
-        file.seek(80);
-        quint32 triangleCount;
-        file.read((char*)&triangleCount, sizeof(triangleCount));
-        m_vertices.reserve(triangleCount * 3U);
-        m_normals.reserve(triangleCount * 3U);
-        m_vertexIndices.reserve(triangleCount * 3U);
-        for(size_t i = 0 ; i < triangleCount ; ++i)
+    }
+
+    if(mesh.indices.isEmpty())
+    {
+        mesh.error = QLatin1String("%1 does not contain any triangles").arg(file.fileName());
+        return false;
+    }
+
+    return true;
+}
+
+bool GeometryProvider::loadBinaryStl(const uchar *data, qint64 size, Mesh &mesh)
+{
+    const quint32 triangleCount = qFromLittleEndian<quint32>(data + 80);
+    const qint64 expected = StlHeaderSize + qint64(triangleCount) * StlRecordSize;
+
+    // a count that runs past the end of the file is a truncated or corrupt
+    // file, trailing bytes after the last record are tolerated
+    if(expected > size)
+    {
+        mesh.error = QLatin1String("Binary STL declares %1 triangles but only has room for %2")
+                         .arg(QString::number(triangleCount), QString::number((size - StlHeaderSize) / StlRecordSize));
+        return false;
+    }
+
+    // every corner of a binary STL repeats its position. they are welded
+    // straight from the mapped records, so the file is never held as three
+    // vertices per triangle. closed meshes come to about half a vertex per
+    // triangle, the table grows for anything else
+    const qsizetype vertexCount = qsizetype(triangleCount) * 3;
+
+    mesh.indices.resize(vertexCount);
+    mesh.vertices.reserve(triangleCount / 2 + 3);
+
+    int *index = mesh.indices.data();
+    WeldTable positionTable(triangleCount / 2 + 3);
+    const uchar *record = data + StlHeaderSize;
+
+    // the facet normal at the start of each record is skipped, exporters
+    // often leave it zero and the normals are rebuilt from the winding
+    for(quint32 triangle = 0; triangle < triangleCount; ++triangle, record += StlRecordSize)
+    {
+        for(int corner = 0; corner < 3; ++corner)
+        {
+            const uchar *position = record + 12 + corner * 12;
+            float key[3] = {
+                qFromLittleEndian<float>(position),
+                qFromLittleEndian<float>(position + 4),
+                qFromLittleEndian<float>(position + 8)
+            };
+            const QVector3D vertex(key[0], key[1], key[2]);
+
+            const qint32 first = positionTable.insert(hashFloats(key, 3), qint32(mesh.vertices.size()), [&](qint32 other) {
+                return mesh.vertices[other] == vertex;
+            });
+
+            if(first == mesh.vertices.size())
+                mesh.vertices << vertex;
+
+            *index++ = first;
+        }
+    }
+
+    mesh.vertices.squeeze();
+    mesh.uniquePositions = true;
+
+    return true;
+}
+
+GeometryProvider::GltfChunks GeometryProvider::gltfChunks(const uchar *data, qint64 size)
+{
+    GltfChunks chunks;
+
+    if(size >= GlbHeaderSize && qFromLittleEndian<quint32>(data) == GlbMagic)
+    {
+        for(qint64 offset = GlbHeaderSize; offset + GlbChunkHeaderSize <= size;)
         {
-            QVector3D n, a, b, c;
-
-            READ_VECTOR(n);
-            READ_VECTOR(a);
-            READ_VECTOR(b);
-            READ_VECTOR(c);
-
-            m_vertexIndices.push_back(m_vertices.size());
-            m_vertexIndices.push_back(m_vertices.size() + 1);
-            m_vertexIndices.push_back(m_vertices.size() + 2);
-            m_vertices.push_back(a);
-            m_vertices.push_back(b);
-            m_vertices.push_back(c);
-
-            quint16 attribute_byte_count;
-            file.read((char*)&attribute_byte_count, sizeof(attribute_byte_count));
+            const qint64 length = qFromLittleEndian<quint32>(data + offset);
+            const quint32 type = qFromLittleEndian<quint32>(data + offset + 4);
+
+            if(offset + GlbChunkHeaderSize + length > size)
+                break;
+
+            if(type == GlbJsonChunk && chunks.json.isNull())
+                chunks.json = QByteArray::fromRawData(reinterpret_cast<const char*>(data + offset + GlbChunkHeaderSize), length);
+
+            else if(type == GlbBinaryChunk && chunks.binaryOffset < 0)
+            {
+                chunks.binaryOffset = offset + GlbChunkHeaderSize;
+                chunks.binaryLength = length;
+            }
+
+            offset += GlbChunkHeaderSize + length;
         }
-        setHasNormals(true);
     }
-    m_verticesNew = m_vertices;
-    recomputeAll();
+    else
+        chunks.json = QByteArray::fromRawData(reinterpret_cast<const char*>(data), size);
+
+    return chunks;
 }
 
-//Bounding Box : http://en.wikibooks.org/wiki/OpenGL_Programming/Bounding_box
-void GeometryProvider::recomputeAll()
+bool GeometryProvider::loadGltf(QFile &file, Mesh &mesh)
 {
-    qDebug() << Q_FUNC_INFO;
+    const qint64 size = file.size();
+    QByteArray contents;
+    uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    const uchar *data = mapped;
+
+    if(!data)
+    {
+        contents = file.readAll();
+        data = reinterpret_cast<const uchar*>(contents.constData());
+    }
 
-    //calculate normals of each face
-    int size = m_verticesNew.size();
-    m_normals.resize(size);
-    for (int i = 0; i < m_vertexIndices.size(); i += 3) {
-        const QVector3D a = m_verticesNew.at(m_vertexIndices.at(i));
-        const QVector3D b = m_verticesNew.at(m_vertexIndices.at(i+1));
-        const QVector3D c = m_verticesNew.at(m_vertexIndices.at(i+2));
+    const qint64 available = mapped ? size : contents.size();
 
-        const QVector3D normal = QVector3D::crossProduct(b - a, c - a).normalized();
+    // a .glb carries the json and the binary buffer as chunks of one file, a
+    // .gltf is the json alone. either way the json is parsed where it lies
+    const GltfChunks chunks = gltfChunks(data, available);
+    GltfBuffer binaryChunk;
 
-        for (int j = 0; j < 3; ++j)
-            m_normals[m_vertexIndices.at(i + j)] += normal;
+    if(chunks.binaryOffset >= 0)
+        binaryChunk = { data + chunks.binaryOffset, chunks.binaryLength };
+
+    QJsonParseError jsonError;
+    const QJsonDocument document = QJsonDocument::fromJson(chunks.json, &jsonError);
+
+    if(jsonError.error != QJsonParseError::NoError || !document.isObject())
+    {
+        mesh.error = QLatin1String("Could not parse %1: %2").arg(file.fileName(), jsonError.errorString());
+        return false;
+    }
+
+    const QJsonObject root = document.object();
+
+    // buffers are the binary chunk, base64 data uris or files next to the
+    // model. files are mapped like the model itself and stay mapped until
+    // the attributes are copied out
+    QVector<GltfBuffer> buffers;
+    QVector<QByteArray> decoded;
+    std::vector<std::unique_ptr<QFile>> externalFiles;
+    const QDir directory = QFileInfo(file).absoluteDir();
+
+    for(const QJsonValue &value : root.value(QLatin1String("buffers")).toArray())
+    {
+        const QJsonObject object = value.toObject();
+        const QString uri = object.value(QLatin1String("uri")).toString();
+        GltfBuffer buffer;
+
+        if(uri.isEmpty())
+            buffer = binaryChunk;
+
+        else if(uri.startsWith(QLatin1String("data:")))
+        {
+            decoded << QByteArray::fromBase64(uri.mid(uri.indexOf(QLatin1Char(',')) + 1).toLatin1());
+            buffer = { reinterpret_cast<const uchar*>(decoded.last().constData()), decoded.last().size() };
+        }
+        else
+        {
+            auto external = std::make_unique<QFile>(gltfBufferPath(directory, uri));
+            const QFileInfo externalInfo(*external);
+
+            // stats taken before reading, a later change always shows
+            mesh.dependencies << Mesh::Dependency { externalInfo.absoluteFilePath(), externalInfo.lastModified().toMSecsSinceEpoch(), externalInfo.size() };
+
+            if(external->open(QIODevice::ReadOnly))
+            {
+                if(const uchar *externalData = external->map(0, external->size()))
+                    buffer = { externalData, external->size() };
+                else
+                {
+                    decoded << external->readAll();
+                    buffer = { reinterpret_cast<const uchar*>(decoded.last().constData()), decoded.last().size() };
+                }
+            }
+
+            externalFiles.push_back(std::move(external));
+        }
+
+        // the binary chunk may be padded past the length of the buffer
+        buffer.size = std::min(buffer.size, object.value(QLatin1String("byteLength")).toInteger());
+        buffers << buffer;
     }
 
-    /* //debug output
-    qDebug() << "=========== Output =============";
-    for (int i = 0; i < m_verticesNew.size(); ++i) {
-        qDebug() << QString("x(%1), y(%2), z(%3)").arg(m_verticesNew.at(i).x()).arg(m_verticesNew.at(i).y()).arg(m_verticesNew.at(i).z());
+    // the default scene with its node transforms, or every mesh as it is if
+    // the file has no scenes
+    QVector<GltfDraw> draws;
+    const QJsonArray scenes = root.value(QLatin1String("scenes")).toArray();
+
+    if(scenes.isEmpty())
+    {
+        for(const QJsonValue &object : root.value(QLatin1String("meshes")).toArray())
+        {
+            for(const QJsonValue &primitive : object.toObject().value(QLatin1String("primitives")).toArray())
+                draws << GltfDraw { primitive.toObject(), QMatrix4x4() };
+        }
     }
+    else
+    {
+        const QJsonObject scene = scenes.at(root.value(QLatin1String("scene")).toInt(0)).toObject();
 
-    for (int i = 0; i< m_vertexIndices.size(); ++i) {
-        qDebug() << QString("index %1").arg(m_vertexIndices.at(i));
+        for(const QJsonValue &node : scene.value(QLatin1String("nodes")).toArray())
+            collectGltfDraws(root, node.toInt(-1), QMatrix4x4(), 0, draws);
     }
 
-    for (int i = 0; i < m_normals.size(); ++i ) {
-        qDebug() << QString("x(%1), y(%2), z(%3)").arg(m_normals.at(i).x()).arg(m_normals.at(i).y()).arg(m_normals.at(i).z());
+    // normals and uvs are only used if every primitive has them, as with the
+    // corners of an OBJ
+    bool hasNormals = !draws.isEmpty();
+    bool hasUv = !draws.isEmpty();
+
+    for(const GltfDraw &draw : draws)
+    {
+        const QJsonObject attributes = draw.primitive.value(QLatin1String("attributes")).toObject();
+
+        hasNormals &= attributes.contains(QLatin1String("NORMAL"));
+        hasUv &= attributes.contains(QLatin1String("TEXCOORD_0"));
     }
-    qDebug() << "========================";
-    */
-    //recompute normals and bounding volume
-    qreal minX, maxX,
-            minY, maxY,
-            minZ, maxZ;
 
-    minX = maxX = m_verticesNew[0].x();
-    minY = maxY = m_verticesNew[0].y();
-    minZ = maxZ = m_verticesNew[0].z();
+    qsizetype skipped = 0;
 
-    for (int i = 0; i < size; ++i) 
+    for(const GltfDraw &draw : draws)
     {
-        //compute normals
-        m_normals[i] = m_normals[i].normalized();
+        const QJsonObject attributes = draw.primitive.value(QLatin1String("attributes")).toObject();
+        GltfAccessor position, normal, texcoord, index;
+
+        const bool valid = draw.primitive.value(QLatin1String("mode")).toInt(GltfTriangles) == GltfTriangles
+            && gltfAccessor(root, buffers, attributes.value(QLatin1String("POSITION")).toInt(-1), position)
+            && position.components == 3
+            && (!hasNormals || (gltfAccessor(root, buffers, attributes.value(QLatin1String("NORMAL")).toInt(-1), normal)
+                                && normal.components == 3 && normal.count == position.count))
+            && (!hasUv || (gltfAccessor(root, buffers, attributes.value(QLatin1String("TEXCOORD_0")).toInt(-1), texcoord)
+                           && texcoord.components == 2 && texcoord.count == position.count))
+            && (!draw.primitive.contains(QLatin1String("indices"))
+                || (gltfAccessor(root, buffers, draw.primitive.value(QLatin1String("indices")).toInt(-1), index)
+                    && index.components == 1 && index.componentType != GltfByte && index.componentType != GltfShort
+                    && index.componentType != GltfFloat));
+
+        const qsizetype base = mesh.vertices.size();
+
+        if(!valid || base + position.count > std::numeric_limits<int>::max())
+        {
+            ++skipped;
+            continue;
+        }
+
+        const QMatrix4x4 &transform = draw.transform;
+        const QMatrix4x4 normalTransform = transform.inverted().transposed();
+        const bool identity = transform.isIdentity();
+
+        mesh.vertices.resize(base + position.count);
+        mesh.normals.resize(hasNormals ? base + position.count : 0);
+        mesh.uv.resize(hasUv ? base + position.count : 0);
+
+        QVector3D *vertex = mesh.vertices.data() + base;
+        QVector3D *vertexNormal = mesh.normals.data() + base;
+        QVector2D *vertexUv = mesh.uv.data() + base;
+
+        // glTF puts the uv origin at the top left, OBJ and the shaders at the
+        // bottom left
+        parallelFor(position.count, MinimumParallelRange, [&](qsizetype, qsizetype begin, qsizetype end) {
+            for(qsizetype i = begin; i < end; ++i)
+            {
+                const QVector3D p(position.component(i, 0), position.component(i, 1), position.component(i, 2));
+                vertex[i] = identity ? p : transform.map(p);
+
+                if(hasNormals)
+                {
+                    const QVector3D n(normal.component(i, 0), normal.component(i, 1), normal.component(i, 2));
+                    vertexNormal[i] = identity ? n : normalTransform.mapVector(n);
+                }
+
+                if(hasUv)
+                    vertexUv[i] = QVector2D(texcoord.component(i, 0), 1.0f - texcoord.component(i, 1));
+            }
+        });
+
+        // a mirroring transform turns the winding around
+        const bool flip = transform.determinant() < 0.0f;
+        const qsizetype corners = (index.data ? index.count : position.count) / 3 * 3;
+        const qsizetype first = mesh.indices.size();
+
+        mesh.indices.resize(first + corners);
+
+        int *corner = mesh.indices.data() + first;
+
+        for(qsizetype i = 0; i < corners; i += 3)
+        {
+            quint32 triangle[3];
+
+            for(int j = 0; j < 3; ++j)
+                triangle[j] = index.data ? index.index(i + j) : quint32(i + j);
+
+            if(triangle[0] >= position.count || triangle[1] >= position.count || triangle[2] >= position.count)
+            {
+                mesh.error = QLatin1String("%1 has indices past the end of its vertices").arg(file.fileName());
+                return false;
+            }
+
+            corner[i] = int(base + triangle[0]);
+            corner[i + 1] = int(base + triangle[flip ? 2 : 1]);
+            corner[i + 2] = int(base + triangle[flip ? 1 : 2]);
+        }
+    }
 
-        //calculate values of maximum and minimum
-        if (m_verticesNew[i].x() < minX) minX = m_verticesNew[i].x();
-        if (m_verticesNew[i].x() > maxX) maxX = m_verticesNew[i].x();
-        if (m_verticesNew[i].y() < minY) minY = m_verticesNew[i].y();
-        if (m_verticesNew[i].y() > maxY) maxY = m_verticesNew[i].y();
-        if (m_verticesNew[i].z() < minZ) minZ = m_verticesNew[i].z();
-        if (m_verticesNew[i].z() > maxZ) maxZ = m_verticesNew[i].z();
+    if(skipped > 0)
+        qWarning() << QLatin1String("Skipped %1 glTF primitives that are not readable triangle lists in %2").arg(QString::number(skipped), file.fileName());
+
+    if(mapped)
+        file.unmap(mapped);
+
+    if(mesh.indices.isEmpty())
+    {
+        mesh.error = QLatin1String("%1 does not contain any triangles").arg(file.fileName());
+        return false;
     }
 
-    m_size   = QVector3D(maxX-minX, maxY-minY, maxZ-minZ);
-    m_center = QVector3D((minX+maxX)/2, (minY+maxY)/2, (minZ+maxZ)/2);
+    mesh.hasNormals = hasNormals;
+    mesh.hasUv = hasUv;
+    mesh.indexedVertices = true;
+
+    return true;
+}
+
+//Bounding Box : http://en.wikibooks.org/wiki/OpenGL_Programming/Bounding_box
+void GeometryProvider::recomputeAll(Mesh &mesh, const Options &options)
+{
+    const qsizetype size = mesh.vertices.size();
+    const qsizetype corners = mesh.indices.size();
+    const qsizetype triangles = corners / 3;
+    const QVector3D *vertices = mesh.vertices.constData();
+    const int *indices = mesh.indices.constData();
+
+    // bounds, a min/max per range that are combined afterwards
+    const qsizetype boundRanges = parallelRanges(size, MinimumParallelRange);
+    std::vector<QVector3D> minimums(boundRanges, vertices[0]);
+    std::vector<QVector3D> maximums(boundRanges, vertices[0]);
 
-    m_min = QVector3D(minX, minY, minZ);
-    m_max = QVector3D(maxX, maxY, maxZ);
+    parallelFor(size, MinimumParallelRange, [&](qsizetype range, qsizetype begin, qsizetype end) {
+        QVector3D &low = minimums[range];
+        QVector3D &high = maximums[range];
 
-    // qDebug() << QLatin1String("MIN : x(%1), y(%2), z(%3)").arg(m_min.x()).arg(m_min.y()).arg(m_min.z());
-    // qDebug() << QLatin1String("MAN : x(%1), y(%2), z(%3)").arg(m_max.x()).arg(m_max.y()).arg(m_max.z());
-    // qDebug() << QLatin1String("SIZE : x(%1), y(%2), z(%3)").arg(m_size.x()).arg(m_size.y()).arg(m_size.z());
+        for(qsizetype i = begin; i < end; ++i)
+        {
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                low[axis] = std::min(low[axis], vertices[i][axis]);
+                high[axis] = std::max(high[axis], vertices[i][axis]);
+            }
+        }
+    });
 
-//    QMatrix4x4 center(1,1,1,1), scale(1,1,1,1);
-//    m_transform.translate(QMatrix4x4(1,1,1) * center)
+    mesh.min = minimums.front();
+    mesh.max = maximums.front();
 
-    int stride = 3 * sizeof(qreal);
+    for(qsizetype range = 1; range < boundRanges; ++range)
+    {
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            mesh.min[axis] = std::min(mesh.min[axis], minimums[range][axis]);
+            mesh.max[axis] = std::max(mesh.max[axis], maximums[range][axis]);
+        }
+    }
 
-    if(hasNormals())
-        stride += 3 * sizeof(qreal);
-    if(hasUv())
-        stride += 2 * sizeof(qreal);
+    // normals are worked out per corner, corners only share a vertex once
+    // they agree on the normal
+    const bool fileNormals = mesh.normals.size() == size;
+    const QVector3D *normals = mesh.normals.constData();
 
-    QByteArray vertexData(3 * stride, Qt::Uninitialized);
-    qreal *pointer = reinterpret_cast<qreal*>(vertexData.data());
+    QVector<QVector3D> faceNormals;
+    QVector<float> cornerWeights;
+    QVector<int> positionIds;
+    QVector<int> offsets;
+    QVector<int> adjacency;
 
-    for(int i = 0; i < m_vertices.count(); i++)
+    if(!fileNormals)
     {
-        *pointer++ = m_vertices.at(i).x();
-        *pointer++ = m_vertices.at(i).y();
-        *pointer++ = m_vertices.at(i).z();
+        faceNormals.resize(triangles);
+        cornerWeights.resize(options.angleWeighted ? corners : 0);
+
+        QVector3D *faceNormal = faceNormals.data();
+        float *cornerWeight = cornerWeights.data();
+
+        parallelFor(triangles, MinimumParallelRange, [&](qsizetype, qsizetype begin, qsizetype end) {
+            for(qsizetype triangle = begin; triangle < end; ++triangle)
+            {
+                const QVector3D *corner[3] = {
+                    &vertices[indices[triangle * 3]],
+                    &vertices[indices[triangle * 3 + 1]],
+                    &vertices[indices[triangle * 3 + 2]]
+                };
+
+                faceNormal[triangle] = QVector3D::crossProduct(*corner[1] - *corner[0], *corner[2] - *corner[0]).normalized();
+
+                if(!options.angleWeighted)
+                    continue;
+
+                for(int i = 0; i < 3; ++i)
+                {
+                    const QVector3D next = (*corner[(i + 1) % 3] - *corner[i]).normalized();
+                    const QVector3D previous = (*corner[(i + 2) % 3] - *corner[i]).normalized();
+
+                    cornerWeight[triangle * 3 + i] = std::acos(std::clamp(QVector3D::dotProduct(next, previous), -1.0f, 1.0f));
+                }
+            }
+        });
+
+        // OBJ files may repeat a position, so faces find their neighbours
+        // through welded positions unless the loader already welded them
+        int positions = int(size);
+
+        if(!mesh.uniquePositions)
+        {
+            positionIds.resize(size);
+            positions = 0;
+
+            WeldTable positionTable(size);
+
+            for(qsizetype i = 0; i < size; ++i)
+            {
+                float key[3] = { vertices[i].x(), vertices[i].y(), vertices[i].z() };
+
+                const qint32 first = positionTable.insert(hashFloats(key, 3), qint32(i), [&](qint32 other) {
+                    return vertices[other] == vertices[i];
+                });
+
+                positionIds[i] = first == i ? positions++ : positionIds[first];
+            }
+        }
+
+        auto positionOf = [&](qsizetype corner) {
+            return positionIds.isEmpty() ? indices[corner] : positionIds[indices[corner]];
+        };
+
+        // corners around every position in CSR form, so each corner can sum
+        // its neighbours on its own without atomics
+        offsets.fill(0, positions + 1);
+        adjacency.resize(corners);
+
+        for(qsizetype corner = 0; corner < corners; ++corner)
+            ++offsets[positionOf(corner) + 1];
+
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
 
-        if(hasNormals())
+        QVector<int> cursor(offsets.cbegin(), offsets.cend() - 1);
+
+        for(qsizetype corner = 0; corner < corners; ++corner)
+            adjacency[cursor[positionOf(corner)]++] = corner;
+    }
+
+    // a little slack so coplanar faces still count at an angle of 0
+    const float creaseCosine = std::cos(qDegreesToRadians(float(options.creaseAngle))) - 1e-4f;
+
+    auto cornerNormal = [&](qsizetype corner) {
+        // read from the file, kept as they are
+        if(fileNormals)
+            return normals[indices[corner]].normalized();
+
+        const QVector3D own = faceNormals[corner / 3];
+        const int position = positionIds.isEmpty() ? indices[corner] : positionIds[indices[corner]];
+        QVector3D sum;
+
+        for(int i = offsets[position]; i < offsets[position + 1]; ++i)
         {
-            *pointer++ = m_normals.at(i).x();
-            *pointer++ = m_normals.at(i).y();
-            *pointer++ = m_normals.at(i).z();
+            const int neighbour = adjacency[i];
+            const QVector3D &other = faceNormals[neighbour / 3];
+
+            if(QVector3D::dotProduct(own, other) >= creaseCosine)
+                sum += options.angleWeighted ? cornerWeights[neighbour] * other : other;
         }
 
-        if(hasUv())
+        return sum.isNull() ? own : sum.normalized();
+    };
+
+    // everything is computed and stored now, lighting needs normals even when
+    // the file had none
+    mesh.hasNormals = true;
+
+    const int floats = 6 + (mesh.hasUv ? 2 : 0);
+    const int stride = floats * sizeof(float);
+
+    auto interleave = [&](float *vertex, int index, const QVector3D &normal) {
+        vertex[0] = vertices[index].x();
+        vertex[1] = vertices[index].y();
+        vertex[2] = vertices[index].z();
+        vertex[3] = normal.x();
+        vertex[4] = normal.y();
+        vertex[5] = normal.z();
+
+        if(mesh.hasUv)
         {
-            *pointer++ = m_uv.at(i).x() - m_uvAdjust;
-            *pointer++ = m_uv.at(i).y() - m_uvAdjust;
+            vertex[6] = mesh.uv.at(index).x() - options.uvAdjust;
+            vertex[7] = mesh.uv.at(index).y() - options.uvAdjust;
         }
+    };
+
+    if(fileNormals && mesh.indexedVertices)
+    {
+        // nothing left to weld, the vertices are interleaved in the order of
+        // the file and its indices are kept as they are
+        QByteArray vertexData(size * stride, Qt::Uninitialized);
+        float *interleaved = reinterpret_cast<float*>(vertexData.data());
+
+        parallelFor(size, MinimumParallelRange, [&](qsizetype, qsizetype begin, qsizetype end) {
+            for(qsizetype i = begin; i < end; ++i)
+                interleave(interleaved + i * floats, int(i), normals[i].normalized());
+        });
+
+        sampleResidentMemory(mesh.residentBase, mesh.peakMemory);
+
+        mesh.wideIndices = size > std::numeric_limits<quint16>::max();
+
+        mesh.vertexData = vertexData;
+        mesh.lods = { indexBuffer(mesh.indices, mesh.wideIndices) };
+        mesh.stride = stride;
+
+        return;
     }
 
-    setBounds(m_min, m_max);
-    setVertexData(vertexData);
-    setStride(stride);
-    
-    setPrimitiveType(QQuick3DGeometry::PrimitiveType::Points);
+    // interleave into float32 and weld on the final bytes, so corners only
+    // share a vertex when position, normal and uv all agree. vertices are
+    // written straight into the buffer that is uploaded, sized for about one
+    // vertex per position and grown when hard edges or seams split more
+    QByteArray vertexData(std::max<qsizetype>(size, 1) * stride, Qt::Uninitialized);
+    QByteArray indexData(corners * sizeof(quint32), Qt::Uninitialized);
+    quint32 *remap = reinterpret_cast<quint32*>(indexData.data());
+    WeldTable vertexTable(size);
+    quint32 count = 0;
 
-    addAttribute(QQuick3DGeometry::Attribute::PositionSemantic,
-                 0,
-                 QQuick3DGeometry::Attribute::F32Type);
+    // normals of a chunk of corners are worked out in parallel, then welded
+    // in order, only one chunk of them is ever held
+    QVector<QVector3D> chunkNormals(std::min(corners, NormalChunkSize));
 
-    if (m_hasNormals) {
-        addAttribute(QQuick3DGeometry::Attribute::NormalSemantic,
-                     3 * sizeof(float),
-                     QQuick3DGeometry::Attribute::F32Type);
+    for(qsizetype chunk = 0; chunk < corners; chunk += NormalChunkSize)
+    {
+        const qsizetype chunkSize = std::min(corners - chunk, NormalChunkSize);
+        QVector3D *chunkNormal = chunkNormals.data();
+
+        parallelFor(chunkSize, MinimumParallelRange, [&](qsizetype, qsizetype begin, qsizetype end) {
+            for(qsizetype i = begin; i < end; ++i)
+                chunkNormal[i] = cornerNormal(chunk + i);
+        });
+
+        for(qsizetype i = 0; i < chunkSize; ++i)
+        {
+            if((qsizetype(count) + 1) * stride > vertexData.size())
+                vertexData.resize(vertexData.size() * 3 / 2 + stride);
+
+            float *interleaved = reinterpret_cast<float*>(vertexData.data());
+            float *vertex = interleaved + qsizetype(count) * floats;
+
+            interleave(vertex, indices[chunk + i], chunkNormal[i]);
+
+            const qint32 first = vertexTable.insert(hashFloats(vertex, floats), qint32(count), [&](qint32 other) {
+                return std::memcmp(interleaved + qsizetype(other) * floats, vertex, stride) == 0;
+            });
+
+            if(first == qint32(count))
+                ++count;
+
+            remap[chunk + i] = first;
+        }
     }
 
-    if (m_hasUV) {
-        addAttribute(QQuick3DGeometry::Attribute::TexCoordSemantic,
-                     m_hasNormals ? 6 * sizeof(float) : 3 * sizeof(float),
-                     QQuick3DGeometry::Attribute::F32Type);
+    // the parsed arrays, the welding scratch and both buffers are all held
+    // here, the most a load ever does at once
+    sampleResidentMemory(mesh.residentBase, mesh.peakMemory);
+
+    vertexData.resize(qsizetype(count) * stride);
+    vertexData.squeeze();
+
+    // 16 bit indices whenever the welded mesh is small enough for them. the
+    // narrowing runs front to back in place, a 16 bit slot never overtakes
+    // the 32 bit one it is read from
+    mesh.wideIndices = count > std::numeric_limits<quint16>::max();
+
+    if(!mesh.wideIndices)
+    {
+        char *bytes = indexData.data();
+
+        for(qsizetype corner = 0; corner < corners; ++corner)
+        {
+            quint32 wide;
+            std::memcpy(&wide, bytes + corner * sizeof(quint32), sizeof(quint32));
+
+            const quint16 narrow = quint16(wide);
+            std::memcpy(bytes + corner * sizeof(quint16), &narrow, sizeof(quint16));
+        }
+
+        indexData.resize(corners * sizeof(quint16));
+        indexData.squeeze();
+    }
+
+    mesh.vertexData = vertexData;
+    mesh.lods = { indexData };
+    mesh.stride = stride;
+}
+
+void GeometryProvider::simplify(Mesh &mesh)
+{
+    const QByteArray &full = mesh.lods.first();
+    const qsizetype indexCount = full.size() / (mesh.wideIndices ? sizeof(quint32) : sizeof(quint16));
+    QVector<quint32> indices(indexCount);
+
+    if(mesh.wideIndices)
+        std::memcpy(indices.data(), full.constData(), full.size());
+    else
+        std::copy_n(reinterpret_cast<const quint16*>(full.constData()), indexCount, indices.begin());
+
+    const int floats = mesh.stride / sizeof(float);
+    MeshSimplifier simplifier(reinterpret_cast<const float*>(mesh.vertexData.constData()), mesh.vertexData.size() / mesh.stride, floats, indices.constData(), indexCount);
+
+    // every level continues from the one before, they all index the same
+    // vertices so the width of the indices stays the same too
+    qsizetype previous = simplifier.triangleCount();
+
+    while(mesh.lods.size() < MaximumLods && previous / 2 >= MinimumLodTriangles)
+    {
+        const qsizetype triangles = simplifier.simplify(previous / 2);
+
+        // stuck on locked vertices or folds, another level would look the same
+        if(triangles > previous * 9 / 10)
+            break;
+
+        mesh.lods << indexBuffer(simplifier.indices(), mesh.wideIndices);
+        previous = triangles;
     }
-}
\ No newline at end of file
+
+    sampleResidentMemory(mesh.residentBase, mesh.peakMemory);
+}
@@ -4,7 +4,7 @@
  *
  *  GeometryProvider.h
  * 
- *  This class provides a way to use .obj and .stl in QML
+ *  This class provides a way to use .obj, .stl and glTF (.gltf, .glb) in QML
  * 
  *  The loadObj() and loadStl() functions are from stl-gcode-viewer
  *  Copyright 2015-2025 @sokunmin | github.com/sokunmin
@@ -25,21 +25,17 @@
 #ifndef  GeometryProvider_H
 #define  GeometryProvider_H
 
-#define READ_VECTOR(v)\
-do {\
-    float f;\
-    file.read((char*)&f, sizeof(float));	v[0] = f;\
-    file.read((char*)&f, sizeof(float));	v[1] = f;\
-    file.read((char*)&f, sizeof(float));	v[2] = f;\
-} while(false)
-
 #include <QObject>
 #include <QQuick3DGeometry>
 #include <QFile>
 #include <QFileInfo>
+#include <QVector2D>
 #include <QVector3D>
 #include <QMatrix4x4>
 
+#include <functional>
+#include <memory>
+
 #include "Komplex_global.h"
 
 class KOMPLEX_EXPORT GeometryProvider : public QQuick3DGeometry
@@ -50,7 +46,16 @@ class KOMPLEX_EXPORT GeometryProvider : public QQuick3DGeometry
     Q_PROPERTY(bool hasNormals READ hasNormals WRITE setHasNormals NOTIFY hasNormalsChanged)
     Q_PROPERTY(bool hasUv READ hasUv WRITE setHasUv NOTIFY hasUvChanged)
     Q_PROPERTY(qreal uvAdjust READ uvAdjust WRITE setUVAdjust NOTIFY uvAdjustChanged)
+    Q_PROPERTY(qreal creaseAngle READ creaseAngle WRITE setCreaseAngle NOTIFY creaseAngleChanged)
+    Q_PROPERTY(bool angleWeightedNormals READ angleWeightedNormals WRITE setAngleWeightedNormals NOTIFY angleWeightedNormalsChanged)
+    Q_PROPERTY(bool buildLods READ buildLods WRITE setBuildLods NOTIFY buildLodsChanged)
+    Q_PROPERTY(int lodBias READ lodBias WRITE setLodBias NOTIFY lodBiasChanged)
+    Q_PROPERTY(int maxTriangles READ maxTriangles WRITE setMaxTriangles NOTIFY maxTrianglesChanged)
+    Q_PROPERTY(int lodCount READ lodCount NOTIFY lodCountChanged)
     Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(State state READ state NOTIFY stateChanged)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(qint64 peakMemory READ peakMemory NOTIFY peakMemoryChanged)
 
 public:
     enum State
@@ -60,6 +65,7 @@ public:
         Loaded,
         Error
     };
+    Q_ENUM(State)
 
     GeometryProvider(QQuick3DObject *parent = nullptr);
 
@@ -69,11 +75,43 @@ public:
     bool hasUv() const { return m_hasUV; }
     void setHasUv(bool enable);
 
-    float uvAdjust() const { return m_uvAdjust; }
+    float uvAdjust() const { return m_options.uvAdjust; }
     void setUVAdjust(qreal f);
 
+    // faces meeting at a sharper angle than this (in degrees) get separate
+    // normals along their shared edge. 0 shades every face flat, 180 smooths
+    // everything
+    qreal creaseAngle() const { return m_options.creaseAngle; }
+    void setCreaseAngle(qreal angle);
+
+    // weights face normals by the corner angle instead of equally
+    bool angleWeightedNormals() const { return m_options.angleWeighted; }
+    void setAngleWeightedNormals(bool enable);
+
+    // simplified levels are built at load time and cached with the mesh,
+    // each one with about half the triangles of the one before
+    bool buildLods() const { return m_options.buildLods; }
+    void setBuildLods(bool enable);
+
+    // levels coarser than the full mesh to draw, 0 draws the full mesh
+    int lodBias() const { return m_lodBias; }
+    void setLodBias(int bias);
+
+    // draws the finest level with at most this many triangles, 0 for no limit
+    int maxTriangles() const { return m_maxTriangles; }
+    void setMaxTriangles(int triangles);
+
+    int lodCount() const { return m_lods.size(); }
+
     QString source() const { return m_source; }
-    void setSource(QString &source);
+    void setSource(const QString &source);
+
+    State state() const { return m_state; }
+    qreal progress() const { return m_progress; }
+
+    // how far the last load grew the resident size of the process at its
+    // peak, in bytes
+    qint64 peakMemory() const { return m_peakMemory; }
 
 Q_SIGNALS:
     void normalsChanged();
@@ -81,32 +119,166 @@ Q_SIGNALS:
     void uvChanged();
     void hasUvChanged();
     void uvAdjustChanged();
+    void creaseAngleChanged();
+    void angleWeightedNormalsChanged();
+    void buildLodsChanged();
+    void lodBiasChanged();
+    void maxTrianglesChanged();
+    void lodCountChanged();
     void sourceChanged();
+    void stateChanged();
+    void progressChanged();
+    void peakMemoryChanged();
+
+protected:
+    void componentComplete() override;
 
 private:
-    void loadObj(QFile &file);
-    void loadStl(QFile &file);
-    void recomputeAll();
+    // everything a load produces. filled on a worker thread and handed to the
+    // geometry in one piece, so the loaders never touch the object itself
+    struct Mesh
+    {
+        QVector<QVector3D> vertices;
+        QVector<QVector3D> normals;
+        QVector<QVector2D> uv;
+        QVector<int> indices;
+
+        // no two entries of vertices are equal, saves welding them again
+        bool uniquePositions = false;
+
+        // every vertex is already a distinct combination of its attributes,
+        // as in glTF. kept as it is when the normals come from the file too
+        bool indexedVertices = false;
+
+        bool hasNormals = false;
+        bool hasUv = false;
+
+        // float32 position, normal and optional uv per vertex
+        QByteArray vertexData;
+        QVector<QByteArray> lods; // index data, the full mesh first
+        bool wideIndices = false; // 32 bit indices, 16 bit otherwise
+        int stride = 0;
+        QVector3D min;
+        QVector3D max;
+
+        // files besides the source the mesh was built from, the external
+        // buffers of a glTF, with their stats at the time they were read
+        struct Dependency
+        {
+            QString path;
+            qint64 modified = 0;
+            qint64 size = 0;
+        };
+
+        QVector<Dependency> dependencies;
+
+        // resident size of the process before the load, and the most the
+        // load grew it by, in bytes
+        qint64 residentBase = 0;
+        qint64 peakMemory = 0;
+
+        QString error;
+    };
+
+    // settings a load is built with, copied into the worker
+    struct Options
+    {
+        qreal uvAdjust = 0.0;
+        qreal creaseAngle = 60.0;
+        bool angleWeighted = false;
+        bool buildLods = false;
+    };
+
+    // called from the worker with the fraction of the load that is done
+    using Progress = std::function<void(qreal)>;
+
+    // binary STL is an 80 byte header and a triangle count, followed by 50
+    // byte records of a normal, three corners and an attribute word
+    static constexpr qint64 StlHeaderSize = 84;
+    static constexpr qint64 StlRecordSize = 50;
+
+    // GLB is a 12 byte header followed by chunks, each starting with its
+    // length and type
+    static constexpr qint64 GlbHeaderSize = 12;
+    static constexpr qint64 GlbChunkHeaderSize = 8;
+
+    // the json of a .gltf or a .glb, pointing into the file, and where the
+    // binary chunk of a .glb lies in it
+    struct GltfChunks
+    {
+        QByteArray json;
+        qint64 binaryOffset = -1;
+        qint64 binaryLength = 0;
+    };
+
+    // bump whenever the buffers built by recomputeAll or the layout of the
+    // file change, older cache files are then rebuilt instead of loaded
+    static constexpr quint32 CacheVersion = 4;
+
+    // size of all cache files together, past it the least recently used
+    // ones are removed
+    static constexpr qint64 CacheSizeLimit = qint64(1) << 30;
+
+    // levels, counting the full mesh, and the smallest one worth building
+    static constexpr int MaximumLods = 8;
+    static constexpr qsizetype MinimumLodTriangles = 256;
+
+    // fewest triangles or vertices worth a thread in recomputeAll
+    static constexpr qsizetype MinimumParallelRange = 1 << 14;
+
+    // corners whose normals are worked out at a time before they are welded
+    // into the vertex buffer, bounds the scratch memory of huge meshes
+    static constexpr qsizetype NormalChunkSize = 1 << 20;
+
+    static std::shared_ptr<Mesh> load(const QString &path, const Options &options, const Progress &progress);
+    static QByteArray cacheKey(const QFileInfo &fileInfo, const Options &options);
+    static QString cachePath(const QFileInfo &fileInfo, const Options &options);
+    static void pruneCache(const QString &directory);
+    static bool loadCache(const QString &path, const QByteArray &key, Mesh &mesh);
+    static void saveCache(const QString &path, const QByteArray &key, const Mesh &mesh);
+    static bool loadObj(QFile &file, Mesh &mesh);
+    static bool loadStl(QFile &file, Mesh &mesh);
+    static bool loadBinaryStl(const uchar *data, qint64 size, Mesh &mesh);
+    static GltfChunks gltfChunks(const uchar *data, qint64 size);
+    static bool loadGltf(QFile &file, Mesh &mesh);
+    static void recomputeAll(Mesh &mesh, const Options &options);
+    static void simplify(Mesh &mesh);
+
+    void scheduleReload();
+    void reload();
+    void apply(const Mesh &mesh);
+    void applyLod();
+    void setState(State state);
+    void setProgress(qreal progress);
 
     bool m_hasNormals = false;
     bool m_hasUV = false;
     
-    qreal m_uvAdjust = 0.0f;
     QString m_source;
+    Options m_options;
+
+    QVector<QByteArray> m_lods;
+    bool m_wideIndices = false;
+    int m_lod = 0;
+    int m_lodBias = 0;
+    int m_maxTriangles = 0;
+
+    State m_state = Idle;
+    qreal m_progress = 0.0;
+    qint64 m_peakMemory = 0;
+
+    // bumped by every change that needs a new load, results of older loads
+    // are dropped
+    quint64 m_generation = 0;
+
+    bool m_componentComplete = false;
+    bool m_reloadPending = false; // a queued reload() picks up every change until it runs
 
     QVector3D m_size;
     QVector3D m_center;
     QVector3D m_min;
     QVector3D m_max;
     QMatrix4x4 m_transform;
-
-    QVector<QVector3D> m_vertices;
-    QVector<QVector3D> m_verticesNew;
-    QVector<QVector3D> m_normals;
-    QVector<QVector2D> m_uv;
-
-    QVector<int> m_edgeIndices;
-    QVector<int> m_vertexIndices;
 };
 
 Q_DECLARE_METATYPE(GeometryProvider)
@@ -0,0 +1,235 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+void MeshSimplifier::Quadric::add(const Quadric &other)
+{
+    for(int i = 0; i < 10; ++i)
+        a[i] += other.a[i];
+}
+
+double MeshSimplifier::Quadric::error(const QVector3D &p) const
+{
+    const double x = p.x(), y = p.y(), z = p.z();
+
+    // [a0 a1 a2 a3; a1 a4 a5 a6; a2 a5 a7 a8; a3 a6 a8 a9] against (x, y, z, 1)
+    return a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+         + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+         + a[7] * z * z + 2.0 * a[8] * z
+         + a[9];
+}
+
+MeshSimplifier::MeshSimplifier(const float *vertices, qsizetype vertexCount, int stride, const quint32 *indices, qsizetype indexCount)
+    : m_positions(vertexCount),
+    m_quadrics(vertexCount),
+    m_triangles(indexCount / 3),
+    m_triangleRemoved(indexCount / 3, false),
+    m_vertexTriangles(vertexCount),
+    m_locked(vertexCount, false),
+    m_vertexRemoved(vertexCount, false),
+    m_versions(vertexCount, 0),
+    m_triangleCount(indexCount / 3)
+{
+    for(qsizetype i = 0; i < vertexCount; ++i)
+        m_positions[i] = QVector3D(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+
+    // every edge once per triangle that uses it, smaller vertex first
+    std::vector<std::pair<quint32, quint32>> edges;
+    edges.reserve(indexCount);
+
+    for(qsizetype triangle = 0; triangle < m_triangleCount; ++triangle)
+    {
+        std::array<quint32, 3> &corners = m_triangles[triangle];
+
+        for(int i = 0; i < 3; ++i)
+            corners[i] = indices[triangle * 3 + i];
+
+        const QVector3D &p0 = m_positions[corners[0]];
+        const QVector3D cross = QVector3D::crossProduct(m_positions[corners[1]] - p0, m_positions[corners[2]] - p0);
+        const float area = cross.length();
+
+        // the plane of the triangle, weighted by its area so slivers count little
+        if(area > 0.0f)
+        {
+            const QVector3D n = cross / area;
+            const double d = -QVector3D::dotProduct(n, p0);
+            const double weight = 0.5 * area;
+
+            Quadric quadric;
+            quadric.a[0] = weight * n.x() * n.x();
+            quadric.a[1] = weight * n.x() * n.y();
+            quadric.a[2] = weight * n.x() * n.z();
+            quadric.a[3] = weight * n.x() * d;
+            quadric.a[4] = weight * n.y() * n.y();
+            quadric.a[5] = weight * n.y() * n.z();
+            quadric.a[6] = weight * n.y() * d;
+            quadric.a[7] = weight * n.z() * n.z();
+            quadric.a[8] = weight * n.z() * d;
+            quadric.a[9] = weight * d * d;
+
+            for(quint32 corner : corners)
+                m_quadrics[corner].add(quadric);
+        }
+
+        for(int i = 0; i < 3; ++i)
+        {
+            m_vertexTriangles[corners[i]].push_back(quint32(triangle));
+            edges.emplace_back(std::minmax(corners[i], corners[(i + 1) % 3]));
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    // an edge with one triangle is open, one with more than two is not a
+    // manifold. neither end of those is ever moved
+    for(size_t first = 0; first < edges.size();)
+    {
+        size_t last = first + 1;
+
+        while(last < edges.size() && edges[last] == edges[first])
+            ++last;
+
+        if(last - first != 2)
+        {
+            m_locked[edges[first].first] = true;
+            m_locked[edges[first].second] = true;
+        }
+
+        first = last;
+    }
+
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    for(const auto &edge : edges)
+        push(edge.first, edge.second);
+}
+
+void MeshSimplifier::push(quint32 a, quint32 b)
+{
+    if(a == b || m_vertexRemoved[a] || m_vertexRemoved[b] || (m_locked[a] && m_locked[b]))
+        return;
+
+    Quadric sum = m_quadrics[a];
+    sum.add(m_quadrics[b]);
+
+    // try both directions, a locked vertex can only be collapsed onto
+    const double intoB = m_locked[a] ? std::numeric_limits<double>::infinity() : sum.error(m_positions[b]);
+    const double intoA = m_locked[b] ? std::numeric_limits<double>::infinity() : sum.error(m_positions[a]);
+
+    if(intoB <= intoA)
+        m_candidates.push({ intoB, a, b, m_versions[a], m_versions[b] });
+    else
+        m_candidates.push({ intoA, b, a, m_versions[b], m_versions[a] });
+}
+
+bool MeshSimplifier::collapse(quint32 from, quint32 to)
+{
+    const QVector3D &target = m_positions[to];
+
+    // refuse collapses that fold a triangle over or squash it to nothing
+    for(quint32 triangle : m_vertexTriangles[from])
+    {
+        if(m_triangleRemoved[triangle])
+            continue;
+
+        const std::array<quint32, 3> &corners = m_triangles[triangle];
+
+        if(corners[0] == to || corners[1] == to || corners[2] == to)
+            continue;
+
+        QVector3D before[3], after[3];
+
+        for(int i = 0; i < 3; ++i)
+        {
+            before[i] = m_positions[corners[i]];
+            after[i] = corners[i] == from ? target : before[i];
+        }
+
+        const QVector3D oldNormal = QVector3D::crossProduct(before[1] - before[0], before[2] - before[0]);
+        const QVector3D newNormal = QVector3D::crossProduct(after[1] - after[0], after[2] - after[0]);
+
+        if(QVector3D::dotProduct(oldNormal, newNormal) <= 0.0f)
+            return false;
+    }
+
+    for(quint32 triangle : m_vertexTriangles[from])
+    {
+        if(m_triangleRemoved[triangle])
+            continue;
+
+        std::array<quint32, 3> &corners = m_triangles[triangle];
+
+        if(corners[0] == to || corners[1] == to || corners[2] == to)
+        {
+            m_triangleRemoved[triangle] = true;
+            --m_triangleCount;
+            continue;
+        }
+
+        for(quint32 &corner : corners)
+        {
+            if(corner == from)
+                corner = to;
+        }
+
+        m_vertexTriangles[to].push_back(triangle);
+    }
+
+    m_quadrics[to].add(m_quadrics[from]);
+    m_vertexRemoved[from] = true;
+    m_vertexTriangles[from] = {};
+    ++m_versions[to];
+
+    // drop removed triangles now and then, the list of a busy vertex grows
+    std::vector<quint32> &around = m_vertexTriangles[to];
+    around.erase(std::remove_if(around.begin(), around.end(), [this](quint32 triangle) { return m_triangleRemoved[triangle]; }), around.end());
+
+    // every edge at the kept vertex has a new cost
+    for(quint32 triangle : around)
+    {
+        for(quint32 corner : m_triangles[triangle])
+        {
+            if(corner != to)
+                push(to, corner);
+        }
+    }
+
+    return true;
+}
+
+qsizetype MeshSimplifier::simplify(qsizetype targetTriangles)
+{
+    while(m_triangleCount > targetTriangles && !m_candidates.empty())
+    {
+        const Candidate candidate = m_candidates.top();
+        m_candidates.pop();
+
+        // stale, one of the ends moved or changed since it was queued
+        if(m_vertexRemoved[candidate.from] || m_vertexRemoved[candidate.to]
+            || m_versions[candidate.from] != candidate.fromVersion || m_versions[candidate.to] != candidate.toVersion)
+            continue;
+
+        collapse(candidate.from, candidate.to);
+    }
+
+    return m_triangleCount;
+}
+
+QVector<quint32> MeshSimplifier::indices() const
+{
+    QVector<quint32> result;
+    result.reserve(m_triangleCount * 3);
+
+    for(size_t triangle = 0; triangle < m_triangles.size(); ++triangle)
+    {
+        if(!m_triangleRemoved[triangle])
+        {
+            for(quint32 corner : m_triangles[triangle])
+                result << corner;
+        }
+    }
+
+    return result;
+}
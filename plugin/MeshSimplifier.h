@@ -0,0 +1,106 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  MeshSimplifier.h
+ *
+ *  Quadric error edge collapse (Garland & Heckbert) for the level of detail
+ *  chain of GeometryProvider. Collapses always move a vertex onto the other
+ *  end of its edge, so every level indexes the same vertex buffer and only
+ *  the index buffers differ between them.
+ *
+ *  Vertices on an open edge are never moved. Vertices split for a hard edge
+ *  or a uv seam sit on such edges as well, which keeps seams and silhouettes
+ *  of open meshes intact at the cost of simplifying less around them.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <QVector>
+#include <QVector3D>
+
+#include <array>
+#include <queue>
+#include <vector>
+
+class MeshSimplifier
+{
+public:
+    /**!
+     * @brief MeshSimplifier
+     * Builds the quadrics and the adjacency of a triangle list.
+     *
+     * @param vertices Interleaved vertices with the position in the first three floats
+     * @param stride Floats per vertex
+     * @param indices Three per triangle
+     */
+    MeshSimplifier(const float *vertices, qsizetype vertexCount, int stride, const quint32 *indices, qsizetype indexCount);
+
+    /**!
+     * @brief simplify
+     * Collapses the cheapest edges until no more than targetTriangles are
+     * left or no edge can be collapsed without folding a triangle over.
+     * Can be called again with a lower target to continue from the result.
+     *
+     * @return number of triangles left
+     */
+    qsizetype simplify(qsizetype targetTriangles);
+
+    qsizetype triangleCount() const { return m_triangleCount; }
+
+    // the remaining triangles, as indices into the original vertices
+    QVector<quint32> indices() const;
+
+private:
+    // symmetric 4x4 matrix of a sum of planes, upper triangle only
+    struct Quadric
+    {
+        double a[10] = {};
+
+        void add(const Quadric &other);
+        double error(const QVector3D &p) const;
+    };
+
+    struct Candidate
+    {
+        double cost;
+        quint32 from;
+        quint32 to;
+        quint32 fromVersion;
+        quint32 toVersion;
+
+        bool operator>(const Candidate &other) const { return cost > other.cost; }
+    };
+
+    void push(quint32 a, quint32 b);
+    bool collapse(quint32 from, quint32 to);
+
+    std::vector<QVector3D> m_positions;
+    std::vector<Quadric> m_quadrics;
+    std::vector<std::array<quint32, 3>> m_triangles;
+    std::vector<bool> m_triangleRemoved;
+    std::vector<std::vector<quint32>> m_vertexTriangles;
+    std::vector<bool> m_locked;
+    std::vector<bool> m_vertexRemoved;
+    std::vector<quint32> m_versions;
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> m_candidates;
+
+    qsizetype m_triangleCount = 0;
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,322 @@
+#include "ObjParser.h"
+#include "ParallelFor.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+enum class Keyword
+{
+    Other,
+    Position,
+    Texcoord,
+    Normal,
+    Face
+};
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+inline const char *skipSpace(const char *p, const char *end)
+{
+    while(p < end && isSpace(*p))
+        ++p;
+
+    return p;
+}
+
+// end of the line starting at p, without the line break
+inline const char *lineEnd(const char *p, const char *end, const char *&next)
+{
+    const char *newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+
+    next = newline ? newline + 1 : end;
+
+    const char *last = newline ? newline : end;
+
+    if(last > p && last[-1] == '\r')
+        --last;
+
+    return last;
+}
+
+// reads the keyword at the start of a line and moves p past it
+inline Keyword keyword(const char *&p, const char *end)
+{
+    p = skipSpace(p, end);
+
+    const char *start = p;
+
+    while(p < end && !isSpace(*p))
+        ++p;
+
+    const qsizetype length = p - start;
+
+    if(length == 1 && start[0] == 'v')
+        return Keyword::Position;
+
+    if(length == 1 && start[0] == 'f')
+        return Keyword::Face;
+
+    if(length == 2 && start[0] == 'v' && start[1] == 't')
+        return Keyword::Texcoord;
+
+    if(length == 2 && start[0] == 'v' && start[1] == 'n')
+        return Keyword::Normal;
+
+    // old exporters still write fo for faces
+    if(length == 2 && start[0] == 'f' && start[1] == 'o')
+        return Keyword::Face;
+
+    return Keyword::Other;
+}
+
+inline const char *readFloat(const char *p, const char *end, float &value)
+{
+    p = skipSpace(p, end);
+
+    // from_chars does not take a leading plus
+    if(p < end && *p == '+')
+        ++p;
+
+    const std::from_chars_result result = std::from_chars(p, end, value);
+
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+// turns a one based or negative relative OBJ index into a zero based one
+inline int resolve(int index, qsizetype before, qsizetype total)
+{
+    const qsizetype resolved = index > 0 ? index - 1 : before + index;
+
+    return index != 0 && resolved >= 0 && resolved < total ? static_cast<int>(resolved) : -2;
+}
+}
+
+void ObjParser::count(Chunk &chunk)
+{
+    const char *next = chunk.begin;
+
+    while(next < chunk.end)
+    {
+        const char *p = next;
+        const char *end = lineEnd(p, chunk.end, next);
+
+        switch(keyword(p, end))
+        {
+        case Keyword::Position:
+            ++chunk.positions;
+            break;
+        case Keyword::Texcoord:
+            ++chunk.texcoords;
+            break;
+        case Keyword::Normal:
+            ++chunk.normals;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void ObjParser::parse(Chunk &chunk)
+{
+    QVector3D *position = m_positions.data() + chunk.positionBase;
+    QVector2D *texcoord = m_texcoords.data() + chunk.texcoordBase;
+    QVector3D *normal = m_normals.data() + chunk.normalBase;
+
+    // attributes read so far, relative indices count back from here
+    qsizetype positions = chunk.positionBase;
+    qsizetype texcoords = chunk.texcoordBase;
+    qsizetype normals = chunk.normalBase;
+
+    QVarLengthArray<Corner, 8> face;
+    const char *next = chunk.begin;
+
+    while(next < chunk.end)
+    {
+        const char *p = next;
+        const char *end = lineEnd(p, chunk.end, next);
+
+        switch(keyword(p, end))
+        {
+        case Keyword::Position:
+        {
+            // a missing coordinate reads as 0 rather than shifting the
+            // numbering of every later vertex
+            float xyz[3] = {};
+
+            for(int i = 0; i < 3 && p; ++i)
+                p = readFloat(p, end, xyz[i]);
+
+            *position++ = QVector3D(xyz[0], xyz[1], xyz[2]);
+            ++positions;
+            break;
+        }
+        case Keyword::Texcoord:
+        {
+            float uv[2] = {};
+
+            for(int i = 0; i < 2 && p; ++i)
+                p = readFloat(p, end, uv[i]);
+
+            *texcoord++ = QVector2D(uv[0], uv[1]);
+            ++texcoords;
+            break;
+        }
+        case Keyword::Normal:
+        {
+            float xyz[3] = {};
+
+            for(int i = 0; i < 3 && p; ++i)
+                p = readFloat(p, end, xyz[i]);
+
+            *normal++ = QVector3D(xyz[0], xyz[1], xyz[2]);
+            ++normals;
+            break;
+        }
+        case Keyword::Face:
+        {
+            face.clear();
+            bool valid = true;
+
+            for(p = skipSpace(p, end); p < end && valid; p = skipSpace(p, end))
+            {
+                Corner corner;
+                int index = 0;
+                std::from_chars_result result = std::from_chars(p, end, index);
+
+                if(result.ec != std::errc())
+                {
+                    valid = false;
+                    break;
+                }
+
+                corner.position = resolve(index, positions, m_positions.size());
+                p = result.ptr;
+
+                // v/vt, v//vn or v/vt/vn
+                if(p < end && *p == '/')
+                {
+                    ++p;
+
+                    if(p < end && *p != '/' && !isSpace(*p))
+                    {
+                        result = std::from_chars(p, end, index);
+                        corner.texcoord = result.ec == std::errc() ? resolve(index, texcoords, m_texcoords.size()) : -2;
+                        p = result.ptr;
+                    }
+
+                    if(p < end && *p == '/')
+                    {
+                        ++p;
+                        result = std::from_chars(p, end, index);
+                        corner.normal = result.ec == std::errc() ? resolve(index, normals, m_normals.size()) : -2;
+                        p = result.ptr;
+                    }
+                }
+
+                valid = corner.position >= 0 && corner.texcoord != -2 && corner.normal != -2 && (p == end || isSpace(*p));
+                face.append(corner);
+            }
+
+            if(!valid || face.size() < 3)
+            {
+                ++chunk.skippedFaces;
+                break;
+            }
+
+            // fan around the first corner, fine for the convex polygons
+            // exporters write
+            for(qsizetype i = 2; i < face.size(); ++i)
+                chunk.corners << face[0] << face[i - 1] << face[i];
+
+            break;
+        }
+        case Keyword::Other:
+            break;
+        }
+    }
+}
+
+bool ObjParser::parse(const char *data, qint64 size)
+{
+    m_positions.clear();
+    m_texcoords.clear();
+    m_normals.clear();
+    m_corners.clear();
+    m_skippedFaces = 0;
+
+    const qint64 threads = parallelRanges(size, MinimumChunkSize);
+    std::vector<Chunk> chunks(threads);
+
+    // cut at line breaks, a chunk may come out empty if a line is huge
+    const char *begin = data;
+    const char *end = data + size;
+
+    for(qint64 i = 0; i < threads; ++i)
+    {
+        const char *split = i + 1 == threads ? end : std::max(begin, data + size * (i + 1) / threads);
+
+        if(split < end)
+        {
+            const char *newline = static_cast<const char*>(std::memchr(split, '\n', end - split));
+            split = newline ? newline + 1 : end;
+        }
+
+        chunks[i].begin = begin;
+        chunks[i].end = split;
+        begin = split;
+    }
+
+    auto forEachChunk = [&chunks](auto function) {
+        parallelFor(chunks.size(), 1, [&chunks, &function](qsizetype, qsizetype begin, qsizetype end) {
+            for(qsizetype i = begin; i < end; ++i)
+                function(chunks[i]);
+        });
+    };
+
+    forEachChunk([](Chunk &chunk) { count(chunk); });
+
+    qsizetype positions = 0, texcoords = 0, normals = 0;
+
+    for(Chunk &chunk : chunks)
+    {
+        chunk.positionBase = positions;
+        chunk.texcoordBase = texcoords;
+        chunk.normalBase = normals;
+
+        positions += chunk.positions;
+        texcoords += chunk.texcoords;
+        normals += chunk.normals;
+    }
+
+    // sized up front, every chunk writes its own slice
+    m_positions.resize(positions);
+    m_texcoords.resize(texcoords);
+    m_normals.resize(normals);
+
+    forEachChunk([this](Chunk &chunk) { parse(chunk); });
+
+    qsizetype corners = 0;
+
+    for(const Chunk &chunk : chunks)
+        corners += chunk.corners.size();
+
+    m_corners.reserve(corners);
+
+    for(const Chunk &chunk : chunks)
+    {
+        m_corners.append(chunk.corners);
+        m_skippedFaces += chunk.skippedFaces;
+    }
+
+    return !m_corners.isEmpty();
+}
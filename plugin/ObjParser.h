@@ -0,0 +1,109 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  ObjParser.h
+ *
+ *  Byte level Wavefront OBJ parser for GeometryProvider. Reads positions,
+ *  texture coordinates, normals and faces with full v/vt/vn index triplets
+ *  straight from a (mapped) buffer, numbers are read with std::from_chars
+ *  so no QString is ever created.
+ *
+ *  Large files are cut into line ranges that are parsed on their own
+ *  threads. A first pass counts the attributes of every range, so each
+ *  thread knows where its attributes start, writes them in place and can
+ *  resolve relative indices on its own. Faces are fan triangulated and the
+ *  triangles of the ranges are concatenated afterwards.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <QHash>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
+
+class ObjParser
+{
+public:
+    // one corner of a triangle, zero based indices or -1 if the face left
+    // the attribute out
+    struct Corner
+    {
+        int position = -1;
+        int texcoord = -1;
+        int normal = -1;
+
+        bool operator==(const Corner &other) const = default;
+    };
+
+    // files smaller than this are not worth a thread of their own
+    static constexpr qint64 MinimumChunkSize = 1 << 20;
+
+    /**!
+     * @brief parse
+     * Parses the whole buffer, replacing the result of any previous call.
+     * Faces with missing or out of range indices are skipped.
+     *
+     * @return false if the buffer did not contain a single triangle
+     */
+    bool parse(const char *data, qint64 size);
+
+    const QVector<QVector3D> &positions() const { return m_positions; }
+    const QVector<QVector2D> &texcoords() const { return m_texcoords; }
+    const QVector<QVector3D> &normals() const { return m_normals; }
+
+    // three corners per triangle
+    const QVector<Corner> &corners() const { return m_corners; }
+
+    // faces that were dropped for bad indices
+    qsizetype skippedFaces() const { return m_skippedFaces; }
+
+private:
+    struct Chunk
+    {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+
+        // attributes in this range, then the number in front of it
+        qsizetype positions = 0;
+        qsizetype texcoords = 0;
+        qsizetype normals = 0;
+        qsizetype positionBase = 0;
+        qsizetype texcoordBase = 0;
+        qsizetype normalBase = 0;
+
+        QVector<Corner> corners;
+        qsizetype skippedFaces = 0;
+    };
+
+    static void count(Chunk &chunk);
+    void parse(Chunk &chunk);
+
+    QVector<QVector3D> m_positions;
+    QVector<QVector2D> m_texcoords;
+    QVector<QVector3D> m_normals;
+    QVector<Corner> m_corners;
+    qsizetype m_skippedFaces = 0;
+};
+
+inline size_t qHash(const ObjParser::Corner &corner, size_t seed = 0)
+{
+    return qHashMulti(seed, corner.position, corner.texcoord, corner.normal);
+}
+
+#endif // OBJPARSER_H
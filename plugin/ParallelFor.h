@@ -0,0 +1,70 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  ParallelFor.h
+ *
+ *  Splits an index range into contiguous pieces and runs each on a thread
+ *  of its own. Used by the geometry loaders, which already run inside the
+ *  global thread pool, so the pieces get dedicated threads instead of
+ *  queueing behind (and waiting on) the task that spawned them.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/**!
+ * @brief parallelRanges
+ * Number of pieces parallelFor() cuts count items into.
+ *
+ * @param minimumRange Fewest items worth a thread of their own
+ */
+inline qsizetype parallelRanges(qsizetype count, qsizetype minimumRange)
+{
+    return std::clamp<qsizetype>(count / std::max<qsizetype>(minimumRange, 1), 1, std::max(1, QThread::idealThreadCount()));
+}
+
+/**!
+ * @brief parallelFor
+ * Calls function(range, begin, end) for every piece of [0, count) and
+ * returns once all of them are done. The last piece runs on the calling
+ * thread, a count below minimumRange never starts a thread at all.
+ */
+template<typename Function>
+void parallelFor(qsizetype count, qsizetype minimumRange, Function function)
+{
+    const qsizetype ranges = parallelRanges(count, minimumRange);
+    std::vector<std::unique_ptr<QThread>> workers;
+
+    for(qsizetype range = 0; range + 1 < ranges; ++range)
+    {
+        workers.emplace_back(QThread::create(function, range, count * range / ranges, count * (range + 1) / ranges));
+        workers.back()->start();
+    }
+
+    function(ranges - 1, count * (ranges - 1) / ranges, count);
+
+    for(auto &worker : workers)
+        worker->wait();
+}
+
+#endif // PARALLELFOR_H
@@ -1,5 +1,11 @@
 #include "ShaderPackModel.h"
 
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QPointer>
+#include <QSaveFile>
+#include <QThreadPool>
+
 ShaderPackModel::ShaderPackModel(QObject *parent)
     : QObject(parent), 
     m_shaderPackPath(QStringLiteral("%1/.local/share/komplex/packs/default")),
@@ -13,19 +19,22 @@ ShaderPackModel::ShaderPackModel(QObject *parent)
 {
     m_metadata = new ShaderPackMetadata;
     initialize();
-    refreshShaderPacks();
-}
 
-ShaderPackModel::~ShaderPackModel()
-{
-    const QStringList keys = m_availableShaderPacks.keys();
+    // the packs of the last scan are there right away, the scan then only
+    // reports what changed since
+    const QHash<QString, Pack> index = loadIndex(indexPath());
 
-    for(const QString &key : keys)
+    for(const Pack &pack : index)
     {
-        ShaderPackMetadata *metadata = m_availableShaderPacks.take(key);
-        metadata->deleteLater();
+        if(pack.valid)
+            m_availableShaderPacks.insert(pack.name, pack);
     }
 
+    refreshShaderPacks();
+}
+
+ShaderPackModel::~ShaderPackModel()
+{
     m_metadata->deleteLater();
 }
 
@@ -172,78 +181,252 @@ void ShaderPackModel::refreshShaderPacks()
 {
     setState(Loading);
 
+    // batches of a scan still running for an earlier refresh are dropped
+    // when they arrive
+    const quint64 generation = ++m_generation;
+    m_scannedShaderPacks.clear();
+
+    // batches come back through the application object, which outlives any
+    // scan. the guard is only read on the gui thread, where the model is
+    // also destroyed
+    QPointer<ShaderPackModel> guard(this);
+    const QString installPath = m_shaderPackInstallPath;
+
+    QThreadPool::globalInstance()->start([guard, generation, installPath]() {
+        auto batch = [guard, generation](const QVector<Pack> &packs, bool finished) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, generation, packs, finished]() {
+                if(guard && guard->m_generation == generation)
+                    guard->mergeShaderPacks(packs, finished);
+            }, Qt::QueuedConnection);
+        };
+
+        scanShaderPacks(installPath, indexPath(), batch);
+    });
+}
+
+void ShaderPackModel::mergeShaderPacks(const QVector<Pack> &packs, bool finished)
+{
+    // packs already listed are updated as they come in, the list itself
+    // only changes once the scan is done. the config dialog selects packs
+    // from it and should not see it shift with every batch
+    for(const Pack &pack : packs)
+    {
+        m_scannedShaderPacks.insert(pack.name, pack);
+
+        if(m_availableShaderPacks.contains(pack.name))
+            m_availableShaderPacks.insert(pack.name, pack);
+    }
+
+    if(!finished)
+        return;
+
+    // whatever the scan did not come across is gone. the list only tells
+    // names apart, new metadata for a known pack is picked up the next time
+    // it is loaded
+    const bool changed = m_scannedShaderPacks.keys() != m_availableShaderPacks.keys();
+
+    m_availableShaderPacks.swap(m_scannedShaderPacks);
+    m_scannedShaderPacks.clear();
+
+    if(changed)
+        Q_EMIT shaderPacksChanged(); // Emit signal to notify that the list has changed
+
+    setState(Idle); // Reset state to Idle
+}
+
+void ShaderPackModel::scanShaderPacks(const QString &installPath, const QString &indexPath, const PackBatch &batch)
+{
     // check for and create the directory if it doesn't exist
-    QDir dir(m_shaderPackInstallPath);
+    QDir dir(installPath);
 
-    if (!dir.exists())
+    if(!dir.exists() && !dir.mkpath(installPath))
     {
-        if (!dir.mkpath(m_shaderPackInstallPath))
-        {
-            setState(Idle); // Reset state to Idle
-            qWarning("Failed to create shader pack directory: %s", qPrintable(m_shaderPackInstallPath));
-            return;
-        }
+        qWarning("Failed to create shader pack directory: %s", qPrintable(installPath));
+        batch({}, true);
+        return;
     }
 
+    const QHash<QString, Pack> index = loadIndex(indexPath);
+    QHash<QString, Pack> scanned;
+    QVector<Pack> found;
+    bool changed = false;
+
     // Get a list of directories in the shader pack path
-    QStringList shaderPacks = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    QMap<QString, ShaderPackMetadata*> verifiedShaderPacks;
+    const QStringList shaderPacks = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
 
     // Only keep shader packs that contain a valid pack.json file
-    for(const QString &pack : std::as_const(shaderPacks))
+    for(const QString &directory : shaderPacks)
     {
-        QDir packDir(dir.absoluteFilePath(pack));
-        ShaderPackMetadata *metadata = new ShaderPackMetadata;
-        bool valid = false;
+        const QFileInfo info(QDir(dir.absoluteFilePath(directory)).absoluteFilePath(QLatin1String("pack.json")));
 
-        // Check if the pack directory contains a pack.json file
-        if(packDir.exists(QString::fromLatin1("pack.json")))
+        if(!info.isFile())
         {
-            // Load the pack.json data
-            QFile packFile(packDir.absoluteFilePath(QString::fromLatin1("pack.json")));
-            if (packFile.open(QIODevice::ReadOnly | QIODevice::Text)) 
-            {
-                QByteArray packData = packFile.readAll();
-                packFile.close(); // close the file immediately after reading
-
-                // Parse the JSON data to validate it
-                QJsonParseError error;
-                QJsonDocument doc = QJsonDocument::fromJson(packData, &error);
-                if (error.error != QJsonParseError::NoError) 
-                {
-                    qWarning("Shader pack %s has invalid JSON: %s at offset %d",
-                             qPrintable(pack), qPrintable(error.errorString()), error.offset);
-                    
-                    continue;
-                }
-                
-                metadata->setAuthor(doc.object().value(QLatin1String("author")).toString());
-                metadata->setDescription(doc.object().value(QLatin1String("description")).toString());
-                metadata->setEngine(doc.object().value(QLatin1String("engine")).toString());
-                metadata->setFile(packDir.absoluteFilePath(QLatin1String("pack.json")));
-                metadata->setId(doc.object().value(QLatin1String("id")).toString());
-                metadata->setLicense(doc.object().value(QLatin1String("license")).toString());
-                metadata->setName(doc.object().value(QLatin1String("name")).toString());
-                metadata->setVersion(doc.object().value(QLatin1String("version")).toString());
-
-                valid = true; // JSON is valid
-            }
+            qWarning("Shader pack %s does not contain a valid pack.json file", qPrintable(directory));
+            continue;
         }
 
-        // If valid, add to the list of verified shader packs
-        if(valid)
+        // unchanged packs are taken from the index without opening them, so
+        // a broken one is also only reported once
+        const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+        Pack pack = index.value(info.absoluteFilePath());
+
+        if(pack.file.isEmpty() || pack.modified != modified || pack.size != info.size())
         {
-            verifiedShaderPacks.insert(metadata->name(), metadata); // Store the path to the pack.json file
+            pack = Pack();
+            pack.file = info.absoluteFilePath();
+            pack.modified = modified;
+            pack.size = info.size();
+            pack.valid = readPack(pack);
+
+            if(!pack.valid)
+                qWarning("Shader pack %s does not contain a valid pack.json file", qPrintable(directory));
+
+            changed = true;
+        }
+
+        scanned.insert(pack.file, pack);
+
+        if(!pack.valid)
+            continue;
+
+        found << pack;
+
+        if(found.size() >= ScanBatchSize)
+        {
+            batch(found, false);
+            found.clear();
         }
-        // Otherwise, log a warning
-        else
-            qWarning("Shader pack %s does not contain a valid pack.json file", qPrintable(pack));
     }
 
-    m_availableShaderPacks = verifiedShaderPacks;
-    Q_EMIT shaderPacksChanged(); // Emit signal to notify that the list has changed
-    
-    setState(Idle); // Reset state to Idle
+    // removed packs drop out of the index as well
+    if(changed || scanned.size() != index.size())
+        saveIndex(indexPath, scanned);
+
+    batch(found, true);
+}
+
+bool ShaderPackModel::readPack(Pack &pack)
+{
+    // Load the pack.json data
+    QFile packFile(pack.file);
+
+    if(!packFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QByteArray packData = packFile.readAll();
+    packFile.close(); // close the file immediately after reading
+
+    // Parse the JSON data to validate it
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(packData, &error);
+
+    if(error.error != QJsonParseError::NoError)
+    {
+        qWarning("Shader pack %s has invalid JSON: %s at offset %d",
+                 qPrintable(pack.file), qPrintable(error.errorString()), error.offset);
+
+        return false;
+    }
+
+    const QJsonObject object = doc.object();
+
+    pack.author = object.value(QLatin1String("author")).toString();
+    pack.description = object.value(QLatin1String("description")).toString();
+    pack.engine = object.value(QLatin1String("engine")).toString();
+    pack.id = object.value(QLatin1String("id")).toString();
+    pack.license = object.value(QLatin1String("license")).toString();
+    pack.name = object.value(QLatin1String("name")).toString();
+    pack.version = object.value(QLatin1String("version")).toString();
+
+    return true;
+}
+
+QString ShaderPackModel::indexPath()
+{
+    return QStringLiteral("%1/.local/share/komplex/cache/packs.json").arg(QStandardPaths::writableLocation(QStandardPaths::HomeLocation));
+}
+
+QHash<QString, ShaderPackModel::Pack> ShaderPackModel::loadIndex(const QString &path)
+{
+    QHash<QString, Pack> packs;
+    QFile file(path);
+
+    if(!file.open(QIODevice::ReadOnly))
+        return packs;
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+    // an index from another version is ignored and rebuilt by the next scan
+    if(root.value(QLatin1String("version")).toInt() != IndexVersion)
+        return packs;
+
+    const QJsonArray entries = root.value(QLatin1String("packs")).toArray();
+
+    for(const QJsonValue &value : entries)
+    {
+        const QJsonObject entry = value.toObject();
+        Pack pack;
+
+        pack.file = entry.value(QLatin1String("file")).toString();
+        pack.modified = entry.value(QLatin1String("modified")).toInteger();
+        pack.size = entry.value(QLatin1String("size")).toInteger();
+        pack.valid = entry.value(QLatin1String("valid")).toBool();
+        pack.author = entry.value(QLatin1String("author")).toString();
+        pack.description = entry.value(QLatin1String("description")).toString();
+        pack.engine = entry.value(QLatin1String("engine")).toString();
+        pack.id = entry.value(QLatin1String("id")).toString();
+        pack.license = entry.value(QLatin1String("license")).toString();
+        pack.name = entry.value(QLatin1String("name")).toString();
+        pack.version = entry.value(QLatin1String("version")).toString();
+
+        if(!pack.file.isEmpty())
+            packs.insert(pack.file, pack);
+    }
+
+    return packs;
+}
+
+void ShaderPackModel::saveIndex(const QString &path, const QHash<QString, Pack> &packs)
+{
+    if(!QDir().mkpath(QFileInfo(path).absolutePath()))
+        return;
+
+    QJsonArray entries;
+
+    for(const Pack &pack : packs)
+    {
+        QJsonObject entry;
+
+        entry.insert(QLatin1String("file"), pack.file);
+        entry.insert(QLatin1String("modified"), pack.modified);
+        entry.insert(QLatin1String("size"), pack.size);
+        entry.insert(QLatin1String("valid"), pack.valid);
+        entry.insert(QLatin1String("author"), pack.author);
+        entry.insert(QLatin1String("description"), pack.description);
+        entry.insert(QLatin1String("engine"), pack.engine);
+        entry.insert(QLatin1String("id"), pack.id);
+        entry.insert(QLatin1String("license"), pack.license);
+        entry.insert(QLatin1String("name"), pack.name);
+        entry.insert(QLatin1String("version"), pack.version);
+
+        entries.append(entry);
+    }
+
+    QJsonObject root;
+    root.insert(QLatin1String("version"), IndexVersion);
+    root.insert(QLatin1String("packs"), entries);
+
+    // written aside and renamed, every wallpaper instance scans on its own
+    // and a reader never sees half a file
+    QSaveFile file(path);
+
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+
+    if(!file.commit())
+        qWarning() << QLatin1String("Could not write the shader pack index %1").arg(path);
 }
 
 void ShaderPackModel::loadShaderPack(const QString &name)
@@ -256,7 +439,7 @@ void ShaderPackModel::loadShaderPack(const QString &name)
         return;
     }
 
-    QString filePath = m_availableShaderPacks.value(name)->file();
+    QString filePath = m_availableShaderPacks.value(name).file;
     loadJson(filePath); // Load the JSON content of the shader pack
 }
 
@@ -396,14 +579,16 @@ void ShaderPackModel::loadMetadata(const QString &name)
     if(!m_availableShaderPacks.contains(name))
         return;
     
-    m_metadata->setAuthor(m_availableShaderPacks[name]->author());
-    m_metadata->setDescription(m_availableShaderPacks[name]->description());
-    m_metadata->setEngine(m_availableShaderPacks[name]->engine());
-    m_metadata->setFile(m_availableShaderPacks[name]->file());
-    m_metadata->setId(m_availableShaderPacks[name]->id());
-    m_metadata->setLicense(m_availableShaderPacks[name]->license());
-    m_metadata->setName(m_availableShaderPacks[name]->name());
-    m_metadata->setVersion(m_availableShaderPacks[name]->version());
+    const Pack &pack = m_availableShaderPacks[name];
+
+    m_metadata->setAuthor(pack.author);
+    m_metadata->setDescription(pack.description);
+    m_metadata->setEngine(pack.engine);
+    m_metadata->setFile(pack.file);
+    m_metadata->setId(pack.id);
+    m_metadata->setLicense(pack.license);
+    m_metadata->setName(pack.name);
+    m_metadata->setVersion(pack.version);
 
     Q_EMIT metadataChanged();
 }
@@ -446,5 +631,5 @@ QString ShaderPackModel::path(const QString &name)
     if(!m_availableShaderPacks.contains(name))
         return QString();
 
-    return m_availableShaderPacks[name]->file();
+    return m_availableShaderPacks[name].file;
 }
\ No newline at end of file
@@ -36,11 +36,15 @@
 #include <QJsonParseError>
 #include <QStandardPaths>
 #include <QDir>
+#include <QHash>
 #include <QMap>
 #include <QProcess>
+#include <QVector>
 #include <QEventLoop>
 #include <QtQml/qqmlregistration.h>
 
+#include <functional>
+
 #include "ShaderPackMetadata.h"
 
 class KOMPLEX_EXPORT ShaderPackModel : public QObject
@@ -92,8 +96,11 @@ public:
     /**!
      * @brief refreshShaderPacks
      * This function refreshes the list of available shader packs by checking
-     * the shader pack directory for valid packs. It emits the shaderPacksChanged() 
-     * signal if the list of available shader packs changes.
+     * the shader pack directory for valid packs. The scan runs on a worker
+     * thread and only parses a pack.json that changed since the last scan,
+     * packs are added as they are found and removed ones once it is done.
+     * It emits the shaderPacksChanged() signal whenever the list changes and
+     * leaves the Loading state when the scan is finished.
      */
     Q_INVOKABLE void refreshShaderPacks();
 
@@ -164,6 +171,40 @@ Q_SIGNALS:
     void metadataChanged();
 
 private:
+    // a pack.json as the index keeps it, plain data so it can be built on
+    // the scan thread
+    struct Pack
+    {
+        QString file;
+        qint64 modified = 0;
+        qint64 size = 0;
+        bool valid = false;
+
+        QString author;
+        QString description;
+        QString engine;
+        QString id;
+        QString license;
+        QString name;
+        QString version;
+    };
+
+    // called from the scan thread with the packs found since the last call
+    using PackBatch = std::function<void(const QVector<Pack> &packs, bool finished)>;
+
+    // bump whenever Pack changes, an older index is then rebuilt
+    static constexpr int IndexVersion = 1;
+
+    // packs handed over at a time while scanning
+    static constexpr qsizetype ScanBatchSize = 32;
+
+    static QString indexPath();
+    static QHash<QString, Pack> loadIndex(const QString &path);
+    static void saveIndex(const QString &path, const QHash<QString, Pack> &packs);
+    static bool readPack(Pack &pack);
+    static void scanShaderPacks(const QString &installPath, const QString &indexPath, const PackBatch &batch);
+
+    void mergeShaderPacks(const QVector<Pack> &packs, bool finished);
     void initialize();
     void copyDirectoryFiles(QString source, QString destination);
     QString m_shaderPackPath;
@@ -179,7 +220,9 @@ private:
     ShaderPackMetadata *m_metadata = nullptr; // currently reported metadata
 
     QString m_json;
-    QMap<QString, ShaderPackMetadata*> m_availableShaderPacks; // Maps shader pack names to their file paths
+    QMap<QString, Pack> m_availableShaderPacks; // Maps shader pack names to their pack.json
+    QMap<QString, Pack> m_scannedShaderPacks; // packs reported by the running scan
+    quint64 m_generation = 0;
     State m_state = Idle;
 
     Q_PROPERTY(QString json READ json WRITE loadJson NOTIFY jsonChanged)
@@ -4,6 +4,7 @@
 
 #include "AudioModel.h"
 #include "AudioImageProvider.h"
+#include "AudioTextureItem.h"
 #include "ShaderPackModel.h"
 #include "PexelsVideoSearch.h"
 #include "PexelsImageSearch.h"
@@ -35,6 +36,7 @@ public:
         Q_ASSERT(QLatin1String(uri) == QLatin1String("com.github.digitalartifex.komplex"));
     
         qmlRegisterSingletonType<AudioModel*>(uri, 1, 0, "AudioModel", komplexAudioSingletonProvider);
+        qmlRegisterType<AudioTextureItem>(uri, 1, 0, "AudioTexture");
         qmlRegisterType<ShaderPackModel>(uri, 1, 0, "ShaderPackModel");
         qmlRegisterType<GeometryProvider>(uri, 1, 0, "GeometryProvider");
         qmlRegisterType<ShaderToySearchModel>(uri, 1, 0, "ShaderToySearchModel");
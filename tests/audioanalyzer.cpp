@@ -0,0 +1,228 @@
+#include "AudioAnalyzer.h"
+#include "AudioKernels.h"
+#include "testsignal.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+/**
+ * Offline check of the audio DSP stage, no PipeWire daemon needed.
+ *
+ * Every case is run through AudioAnalyzer the way AudioModel runs the
+ * capture with its default settings: converted to mono, one frame every hop,
+ * and the texture of the last frame is compared against the golden image of
+ * the case. The time and the heap allocations per analyze() are reported
+ * along with it, analyze() allocating at all fails the case.
+ *
+ * After an intended change to the analysis, --update rewrites the golden
+ * images from the current output.
+ */
+
+namespace
+{
+using namespace TestSignal;
+
+std::atomic<quint64> allocations = 0;
+
+// AudioModel defaults
+constexpr int FftSize = 2048;
+constexpr int TextureWidth = 512;
+constexpr int HopSize = 512;
+constexpr float TimeConstant = 0.8f;
+
+// 8-bit steps a texel may differ from the golden image by. FFTW picks its
+// algorithm by measuring and the vector kernels round differently from the
+// scalar ones, neither is bit exact between machines
+constexpr int Tolerance = 2;
+
+struct Result
+{
+    QImage texture;
+    int frames = 0;
+    qint64 nanoseconds = 0;
+    quint64 allocations = 0;
+};
+
+/**!
+ * @brief run
+ * Analyses the whole signal, one frame every hop, and keeps the texture of
+ * the last frame.
+ */
+Result run(const Signal &signal)
+{
+    Result result;
+
+    AudioAnalyzer analyzer(AudioAnalyzer::scaledSize(FftSize, signal.rate), signal.rate, 1, TextureWidth);
+
+    const quint64 frames = signal.samples.size() / signal.channels;
+    std::vector<float> converted(frames);
+    AudioAnalyzer::convert(signal.samples.data(), signal.channels, 0, frames, 1, converted.data());
+
+    const int size = analyzer.size();
+    const int hop = analyzer.scaled(HopSize);
+    const float seconds = static_cast<float>(hop) / signal.rate;
+
+    QElapsedTimer timer;
+
+    for(quint64 start = 0; start + size <= frames; start += hop)
+    {
+        std::copy_n(converted.data() + start, size, analyzer.frame());
+
+        const quint64 before = allocations.load(std::memory_order_relaxed);
+        timer.start();
+
+        analyzer.analyze(TimeConstant, 0.0f, seconds);
+
+        result.nanoseconds += timer.nsecsElapsed();
+        result.allocations += allocations.load(std::memory_order_relaxed) - before;
+        ++result.frames;
+    }
+
+    const QSize textureSize = analyzer.textureSize();
+    result.texture = QImage(analyzer.texture(), textureSize.width(), textureSize.height(), textureSize.width(), QImage::Format_Grayscale8).copy();
+
+    return result;
+}
+
+// largest difference of two grayscale images of the same size
+int maxDifference(const QImage &expected, const QImage &actual)
+{
+    int difference = 0;
+
+    for(int y = 0; y < actual.height(); ++y)
+    {
+        const uchar *a = expected.constScanLine(y);
+        const uchar *b = actual.constScanLine(y);
+
+        for(int x = 0; x < actual.width(); ++x)
+            difference = std::max(difference, std::abs(a[x] - b[x]));
+    }
+
+    return difference;
+}
+}
+
+// counts every heap allocation of the process, see Result::allocations
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if(void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs test signals through the audio analysis and compares the textures with golden images"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("directory"), QStringLiteral("Directory of the golden images and the WAV input"));
+
+    const QCommandLineOption update(QStringLiteral("update"), QStringLiteral("Writes the golden images instead of comparing against them"));
+    parser.addOption(update);
+    parser.process(application);
+
+    const QDir directory(parser.positionalArguments().value(0, QStringLiteral(".")));
+
+    const std::vector<std::pair<QString, std::function<bool(Signal &)>>> cases = {
+        {QStringLiteral("sine"), [](Signal &signal) { sine(signal, 440.0, 0.5, 1.0); return true; }},
+        {QStringLiteral("sweep"), [](Signal &signal) { sweep(signal, 20.0, 11025.0, 1.0); return true; }},
+        {QStringLiteral("noise"), [](Signal &signal) { noise(signal, 0.25, 1.0); return true; }},
+        {QStringLiteral("silence"), [](Signal &signal) { sine(signal, 440.0, 0.0, 1.0); return true; }},
+        {QStringLiteral("clipping"), [](Signal &signal) {
+             sine(signal, 440.0, 4.0, 1.0);
+
+             for(float &sample : signal.samples)
+                 sample = std::clamp(sample, -1.0f, 1.0f);
+
+             return true;
+         }},
+        {QStringLiteral("chord"), [&directory](Signal &signal) { return readWav(directory.filePath(QStringLiteral("chord.wav")), signal); }},
+    };
+
+    std::printf("kernels %s\n", AudioKernels::implementation());
+    std::printf("%-10s %8s %12s %14s %10s\n", "case", "frames", "ns/frame", "allocs/frame", "max diff");
+
+    bool passed = true;
+
+    for(const auto &[name, generate] : cases)
+    {
+        Signal signal;
+
+        if(!generate(signal))
+        {
+            std::printf("%-10s FAIL no input\n", qPrintable(name));
+            passed = false;
+            continue;
+        }
+
+        const Result result = run(signal);
+        const QString golden = directory.filePath(name + QStringLiteral(".png"));
+
+        bool ok = result.allocations == 0;
+        int difference = 0;
+
+        if(parser.isSet(update))
+        {
+            if(!result.texture.save(golden))
+            {
+                qWarning("Could not write %s", qPrintable(golden));
+                ok = false;
+            }
+        }
+        else
+        {
+            const QImage expected = QImage(golden).convertToFormat(QImage::Format_Grayscale8);
+
+            if(expected.size() != result.texture.size())
+            {
+                qWarning("%s is missing or not %dx%d", qPrintable(golden), result.texture.width(), result.texture.height());
+                ok = false;
+            }
+            else
+            {
+                difference = maxDifference(expected, result.texture);
+                ok = ok && difference <= Tolerance;
+            }
+        }
+
+        const int frames = std::max(result.frames, 1);
+
+        std::printf("%-10s %8d %12.0f %14.2f %10d %s\n",
+                    qPrintable(name),
+                    result.frames,
+                    double(result.nanoseconds) / frames,
+                    double(result.allocations) / frames,
+                    difference,
+                    ok ? "ok" : "FAIL");
+
+        passed = passed && ok;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
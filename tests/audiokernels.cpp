@@ -0,0 +1,205 @@
+#include "AudioKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+/**
+ * Runs every kernel set the CPU supports against the Scalar reference.
+ *
+ * Lengths around the 4 and 8 lane widths leave remainders for the scalar
+ * tails, and inputs and outputs are offset by single elements from the
+ * allocation, so the vector loads and stores also see unaligned pointers.
+ * Floats are compared with a relative tolerance, the byte conversions may
+ * differ by one 8-bit step.
+ */
+
+namespace
+{
+using namespace AudioKernels;
+
+constexpr int Lengths[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 255, 257, 1023, 1025};
+constexpr int Offsets = 4; // elements past the allocation, 0 to 3
+constexpr quint32 Channels[] = {1, 2, 3, 6};
+
+// xorshift, every run sees the same input
+quint32 state = 0x12345678;
+
+float random(float low, float high)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return low + (high - low) * static_cast<float>(state / 4294967295.0);
+}
+
+std::vector<float> randomBuffer(size_t size, float low, float high)
+{
+    std::vector<float> buffer(size);
+
+    for(float &value : buffer)
+        value = random(low, high);
+
+    return buffer;
+}
+
+// magnitudes from silence to full scale, with zeros, so decibelBytes sees
+// every part of its range including the clamps
+std::vector<float> magnitudeBuffer(size_t size)
+{
+    std::vector<float> buffer(size);
+
+    for(size_t i = 0; i < size; ++i)
+        buffer[i] = i % 7 == 0 ? 0.0f : std::exp2(random(-24.0f, 1.0f));
+
+    return buffer;
+}
+
+class Checker
+{
+public:
+    explicit Checker(const char *set)
+        : m_set(set)
+    {
+    }
+
+    void floats(const char *kernel, int length, int offset, const float *expected, const float *actual, int count, float tolerance)
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            const bool equal = expected[i] == actual[i] || (std::isnan(expected[i]) && std::isnan(actual[i]));
+
+            if(!equal && !(std::abs(expected[i] - actual[i]) <= tolerance * std::max(1.0f, std::abs(expected[i]))))
+            {
+                fail(kernel, length, offset, i, expected[i], actual[i]);
+                return;
+            }
+        }
+    }
+
+    void bytes(const char *kernel, int length, int offset, const uchar *expected, const uchar *actual, int count)
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            if(std::abs(expected[i] - actual[i]) > 1)
+            {
+                fail(kernel, length, offset, i, expected[i], actual[i]);
+                return;
+            }
+        }
+    }
+
+    int failures() const { return m_failures; }
+
+private:
+    void fail(const char *kernel, int length, int offset, int index, double expected, double actual)
+    {
+        std::printf("%s::%s length %d offset %d: [%d] is %g, scalar gives %g\n", m_set, kernel, length, offset, index, actual, expected);
+        ++m_failures;
+    }
+
+    const char *m_set;
+    int m_failures = 0;
+};
+
+void check(const KernelTable &kernels, const KernelTable &scalar, Checker &checker)
+{
+    for(const int length : Lengths)
+    {
+        for(int offset = 0; offset < Offsets; ++offset)
+        {
+            const size_t size = length + Offsets;
+
+            for(const quint32 channels : Channels)
+            {
+                const std::vector<float> interleaved = randomBuffer(length * channels + Offsets, -1.0f, 1.0f);
+                std::vector<float> expected(length * channels + Offsets);
+                std::vector<float> actual(length * channels + Offsets);
+
+                scalar.downmix(interleaved.data() + offset, length, channels, expected.data() + offset);
+                kernels.downmix(interleaved.data() + offset, length, channels, actual.data() + offset);
+                checker.floats("downmix", length, offset, expected.data() + offset, actual.data() + offset, length, 1e-6f);
+
+                scalar.deinterleave(interleaved.data() + offset, length, channels, expected.data() + offset);
+                kernels.deinterleave(interleaved.data() + offset, length, channels, actual.data() + offset);
+                checker.floats("deinterleave", length, offset, expected.data() + offset, actual.data() + offset, length * channels, 0.0f);
+            }
+
+            const std::vector<float> samples = randomBuffer(size, -1.0f, 1.0f);
+            const std::vector<float> window = randomBuffer(size, 0.0f, 1.0f);
+            std::vector<float> expected(size);
+            std::vector<float> actual(size);
+
+            // summed in a different order, the error grows with the length
+            const float sum = scalar.sumOfSquares(samples.data() + offset, length);
+            const float vectorSum = kernels.sumOfSquares(samples.data() + offset, length);
+            checker.floats("sumOfSquares", length, offset, &sum, &vectorSum, 1, 1e-5f);
+
+            scalar.applyWindow(samples.data() + offset, window.data() + offset, expected.data() + offset, length);
+            kernels.applyWindow(samples.data() + offset, window.data() + offset, actual.data() + offset, length);
+            checker.floats("applyWindow", length, offset, expected.data() + offset, actual.data() + offset, length, 0.0f);
+
+            const std::vector<float> spectrum = randomBuffer(size * 2, -100.0f, 100.0f);
+            scalar.magnitude(spectrum.data() + offset, expected.data() + offset, length, 1.0f / 2048);
+            kernels.magnitude(spectrum.data() + offset, actual.data() + offset, length, 1.0f / 2048);
+            checker.floats("magnitude", length, offset, expected.data() + offset, actual.data() + offset, length, 1e-6f);
+
+            // a few non finite magnitudes, smooth resets those bins to 0
+            std::vector<float> magnitudes = magnitudeBuffer(size);
+
+            for(size_t i = 3; i < magnitudes.size(); i += 11)
+                magnitudes[i] = i % 2 ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN();
+
+            expected = magnitudeBuffer(size);
+            actual = expected;
+            scalar.smooth(magnitudes.data() + offset, expected.data() + offset, length, 0.8f);
+            kernels.smooth(magnitudes.data() + offset, actual.data() + offset, length, 0.8f);
+            checker.floats("smooth", length, offset, expected.data() + offset, actual.data() + offset, length, 1e-6f);
+
+            magnitudes = magnitudeBuffer(size);
+            expected = magnitudeBuffer(size);
+            actual = expected;
+            scalar.peakHold(magnitudes.data() + offset, expected.data() + offset, length, 0.95f);
+            kernels.peakHold(magnitudes.data() + offset, actual.data() + offset, length, 0.95f);
+            checker.floats("peakHold", length, offset, expected.data() + offset, actual.data() + offset, length, 0.0f);
+
+            std::vector<uchar> expectedBytes(size);
+            std::vector<uchar> actualBytes(size);
+
+            scalar.decibelBytes(magnitudes.data() + offset, expectedBytes.data() + offset, length, -100.0f);
+            kernels.decibelBytes(magnitudes.data() + offset, actualBytes.data() + offset, length, -100.0f);
+            checker.bytes("decibelBytes", length, offset, expectedBytes.data() + offset, actualBytes.data() + offset, length);
+
+            // past the clamp of the waveform formula on both sides
+            const std::vector<float> loud = randomBuffer(size, -5.0f, 5.0f);
+            scalar.waveBytes(loud.data() + offset, expectedBytes.data() + offset, length);
+            kernels.waveBytes(loud.data() + offset, actualBytes.data() + offset, length);
+            checker.bytes("waveBytes", length, offset, expectedBytes.data() + offset, actualBytes.data() + offset, length);
+        }
+    }
+}
+}
+
+int main()
+{
+    const std::vector<KernelTable> tables = supportedKernels();
+    int failures = 0;
+
+    // the last one is Scalar itself
+    for(size_t i = 0; i + 1 < tables.size(); ++i)
+    {
+        const KernelTable &kernels = tables[i];
+
+        Checker checker(kernels.name);
+        check(kernels, tables.back(), checker);
+
+        std::printf("%-8s %s\n", kernels.name, checker.failures() ? "FAIL" : "ok");
+        failures += checker.failures();
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#include "AudioAnalyzer.h"
+#include "AudioSharedFrame.h"
+#include "testsignal.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * Stands in for the capture of a wallpaper. A test signal is analysed in
+ * real time, one frame every hop, and published into the shared memory
+ * segment /komplex-audio-<uid> exactly like AudioModel does as the
+ * producer. Running wallpapers and config dialogs attach to it as
+ * consumers, so sharing, takeover and audio reactive shaders can be tried
+ * without PipeWire or anything playing.
+ *
+ * If a wallpaper is the producer already, this waits for it to go away.
+ */
+
+namespace
+{
+using namespace TestSignal;
+
+// what AudioModel opens the segment with, MaximumTextureWidth *
+// MaximumTextureHeight. consumers map the whole segment, so it must not
+// shrink underneath them
+constexpr quint32 Capacity = 4096 * 16;
+
+constexpr int HopSize = 512;
+constexpr float TimeConstant = 0.8f;
+
+// synthetic signals are generated this long and looped
+constexpr double SignalSeconds = 10.0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Publishes the analysis of a test signal as the shared Komplex audio frame"));
+    parser.addHelpOption();
+
+    const QCommandLineOption signalOption({QStringLiteral("s"), QStringLiteral("signal")},
+                                          QStringLiteral("Synthetic signal to play, sine, sweep or noise"), QStringLiteral("signal"), QStringLiteral("sweep"));
+    const QCommandLineOption frequencyOption({QStringLiteral("f"), QStringLiteral("frequency")},
+                                             QStringLiteral("Frequency of the sine in Hz"), QStringLiteral("hz"), QStringLiteral("440"));
+    const QCommandLineOption wavOption({QStringLiteral("w"), QStringLiteral("wav")},
+                                       QStringLiteral("Plays a WAV file in a loop instead"), QStringLiteral("file"));
+    const QCommandLineOption channelsOption({QStringLiteral("c"), QStringLiteral("channels")},
+                                            QStringLiteral("Channels analysed separately, at most those of the input"), QStringLiteral("count"), QStringLiteral("1"));
+    const QCommandLineOption sizeOption(QStringLiteral("fft-size"),
+                                        QStringLiteral("Samples per analysis frame at 44.1kHz"), QStringLiteral("size"), QStringLiteral("2048"));
+    const QCommandLineOption widthOption(QStringLiteral("width"),
+                                         QStringLiteral("Width of the audio texture"), QStringLiteral("width"), QStringLiteral("512"));
+    const QCommandLineOption durationOption({QStringLiteral("d"), QStringLiteral("duration")},
+                                            QStringLiteral("Seconds to publish for, 0 runs until interrupted"), QStringLiteral("seconds"), QStringLiteral("0"));
+
+    parser.addOptions({signalOption, frequencyOption, wavOption, channelsOption, sizeOption, widthOption, durationOption});
+    parser.process(application);
+
+    Signal signal;
+
+    if(parser.isSet(wavOption))
+    {
+        if(!readWav(parser.value(wavOption), signal))
+            return EXIT_FAILURE;
+    }
+    else
+    {
+        const QString kind = parser.value(signalOption);
+
+        if(kind == QStringLiteral("sine"))
+            sine(signal, parser.value(frequencyOption).toDouble(), 0.5, SignalSeconds);
+        else if(kind == QStringLiteral("sweep"))
+            sweep(signal, 20.0, 20000.0, SignalSeconds);
+        else if(kind == QStringLiteral("noise"))
+            noise(signal, 0.25, SignalSeconds);
+        else
+        {
+            qWarning("Unknown signal %s", qPrintable(kind));
+            return EXIT_FAILURE;
+        }
+    }
+
+    const quint64 frames = signal.samples.size() / signal.channels;
+
+    if(frames == 0)
+    {
+        qWarning("The signal is empty");
+        return EXIT_FAILURE;
+    }
+
+    const quint32 channels = std::clamp<quint32>(parser.value(channelsOption).toUInt(), 1, signal.channels);
+    const int width = std::clamp(parser.value(widthOption).toInt(), 16, 4096);
+    const int fftSize = std::clamp(parser.value(sizeOption).toInt(), 256, 8192);
+
+    AudioAnalyzer analyzer(AudioAnalyzer::scaledSize(fftSize, signal.rate), signal.rate, channels, width);
+
+    std::unique_ptr<AudioSharedFrame> frame = AudioSharedFrame::open(Capacity);
+
+    if(!frame)
+    {
+        qWarning("Could not open the shared audio frame");
+        return EXIT_FAILURE;
+    }
+
+    if(frame->role() != AudioSharedFrame::Producer)
+    {
+        std::printf("Another process publishes the audio frame, waiting for it to exit\n");
+
+        while(!frame->tryPromote())
+            QThread::msleep(100);
+    }
+
+    std::printf("Publishing %dx%d frames to /komplex-audio-%u\n", analyzer.textureSize().width(), analyzer.textureSize().height(), getuid());
+    std::fflush(stdout);
+
+    const int size = analyzer.size();
+    const int hop = analyzer.scaled(HopSize);
+    const auto period = std::chrono::nanoseconds(1000000000LL * hop / signal.rate);
+    const double duration = parser.value(durationOption).toDouble();
+
+    auto deadline = std::chrono::steady_clock::now();
+    const auto end = duration > 0.0 ? deadline + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(duration))
+                                    : std::chrono::steady_clock::time_point::max();
+
+    quint64 position = 0;
+
+    while(deadline < end)
+    {
+        // the frame starting at position, wrapping around the end of the signal
+        for(quint64 copied = 0; copied < quint64(size);)
+        {
+            const quint64 start = (position + copied) % frames;
+            const quint64 count = std::min<quint64>(size - copied, frames - start);
+
+            AudioAnalyzer::convert(signal.samples.data(), signal.channels, start * channels, count * channels, channels, analyzer.frame() + copied * channels);
+            copied += count;
+        }
+
+        analyzer.analyze(TimeConstant, 0.0f, static_cast<float>(hop) / signal.rate);
+
+        const qint64 now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        frame->publish(analyzer.texture(), analyzer.textureSize(), now, analyzer.features());
+
+        position = (position + hop) % frames;
+        deadline += period;
+
+        std::this_thread::sleep_until(deadline);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include "testsignal.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <cstring>
+#include <math.h>
+
+namespace TestSignal
+{
+void sine(Signal &signal, double frequency, double amplitude, double seconds)
+{
+    signal.channels = 1;
+    signal.samples.resize(static_cast<size_t>(seconds * signal.rate));
+
+    for(size_t i = 0; i < signal.samples.size(); ++i)
+        signal.samples[i] = static_cast<float>(amplitude * std::sin(2.0 * M_PI * frequency * i / signal.rate));
+}
+
+void sweep(Signal &signal, double from, double to, double seconds)
+{
+    signal.channels = 1;
+    signal.samples.resize(static_cast<size_t>(seconds * signal.rate));
+
+    const double rate = std::log(to / from) / seconds;
+
+    for(size_t i = 0; i < signal.samples.size(); ++i)
+    {
+        const double time = double(i) / signal.rate;
+        const double phase = 2.0 * M_PI * from * (std::exp(rate * time) - 1.0) / rate;
+
+        signal.samples[i] = static_cast<float>(0.5 * std::sin(phase));
+    }
+}
+
+void noise(Signal &signal, double amplitude, double seconds)
+{
+    signal.channels = 1;
+    signal.samples.resize(static_cast<size_t>(seconds * signal.rate));
+
+    quint32 state = 0x12345678;
+
+    for(float &sample : signal.samples)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        sample = static_cast<float>(amplitude * (state / 2147483647.5 - 1.0));
+    }
+}
+
+bool readWav(const QString &path, Signal &signal)
+{
+    QFile file(path);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        qWarning("Could not open %s", qPrintable(path));
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    const char *bytes = data.constData();
+
+    if(data.size() < 12 || std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0)
+    {
+        qWarning("%s is not a WAV file", qPrintable(path));
+        return false;
+    }
+
+    quint16 format = 0;
+    quint16 bits = 0;
+
+    for(qsizetype offset = 12; offset + 8 <= data.size();)
+    {
+        const char *chunk = bytes + offset + 8;
+        const quint32 size = qFromLittleEndian<quint32>(bytes + offset + 4);
+
+        if(size > data.size() - offset - 8)
+            break;
+
+        if(std::memcmp(bytes + offset, "fmt ", 4) == 0 && size >= 16)
+        {
+            format = qFromLittleEndian<quint16>(chunk);
+            signal.channels = qFromLittleEndian<quint16>(chunk + 2);
+            signal.rate = qFromLittleEndian<quint32>(chunk + 4);
+            bits = qFromLittleEndian<quint16>(chunk + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE keeps the actual format in its sub format
+            if(format == 0xFFFE && size >= 26)
+                format = qFromLittleEndian<quint16>(chunk + 24);
+        }
+        else if(std::memcmp(bytes + offset, "data", 4) == 0)
+        {
+            if(signal.channels == 0 || signal.rate == 0)
+                break;
+
+            if(format == 1 && bits == 16)
+            {
+                signal.samples.resize(size / 2);
+
+                for(size_t i = 0; i < signal.samples.size(); ++i)
+                    signal.samples[i] = qFromLittleEndian<qint16>(chunk + i * 2) / 32768.0f;
+            }
+            else if(format == 3 && bits == 32)
+            {
+                signal.samples.resize(size / 4);
+
+                for(size_t i = 0; i < signal.samples.size(); ++i)
+                {
+                    const quint32 value = qFromLittleEndian<quint32>(chunk + i * 4);
+                    std::memcpy(&signal.samples[i], &value, sizeof(float));
+                }
+            }
+            else
+            {
+                qWarning("%s is neither 16-bit PCM nor 32-bit float", qPrintable(path));
+                return false;
+            }
+
+            return true;
+        }
+
+        offset += 8 + size + (size & 1);
+    }
+
+    qWarning("%s has no audio data", qPrintable(path));
+    return false;
+}
+}
@@ -0,0 +1,73 @@
+/*
+ *  Komplex Wallpaper Engine
+ *  Copyright (C) 2025 @DigitalArtifex | github.com/DigitalArtifex
+ *
+ *  testsignal.h
+ *
+ *  Audio input for the offline tools in this directory, deterministic
+ *  synthetic signals and WAV files, as interleaved float32 the way
+ *  PipeWire delivers it.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef TESTSIGNAL_H
+#define TESTSIGNAL_H
+
+#include <QtGlobal>
+#include <QString>
+
+#include "AudioAnalyzer.h"
+
+#include <vector>
+
+namespace TestSignal
+{
+struct Signal
+{
+    quint32 rate = AudioAnalyzer::ReferenceRate;
+    quint32 channels = 1;
+    std::vector<float> samples; // interleaved
+};
+
+/**!
+ * @brief sine
+ * Replaces signal with a mono sine of the given length.
+ */
+void sine(Signal &signal, double frequency, double amplitude, double seconds);
+
+/**!
+ * @brief sweep
+ * Replaces signal with a mono exponential sweep, the same time per octave,
+ * at half of full scale.
+ */
+void sweep(Signal &signal, double from, double to, double seconds);
+
+/**!
+ * @brief noise
+ * Replaces signal with mono white noise from a fixed seed, so every run
+ * sees the same samples.
+ */
+void noise(Signal &signal, double amplitude, double seconds);
+
+/**!
+ * @brief readWav
+ * Reads a 16-bit PCM or 32-bit float WAV file into signal.
+ *
+ * @return false with a warning if the file cannot be read
+ */
+bool readWav(const QString &path, Signal &signal);
+}
+
+#endif // TESTSIGNAL_H
@@ -13,7 +13,8 @@ output_directory = 'processed'
 variables_to_update = [
     'iTime', 'iTimeDelta', 'iFrameRate', 'iSampleRate',
     'iFrame', 'iDate', 'iMouse', 'iResolution',
-    r'iChannelTime', r'iChannelResolution'
+    r'iChannelTime', r'iChannelResolution',
+    'iAudioBands', 'iAudioBeat'
 ]
 
 # Header to be prepended to the shader file
@@ -35,6 +36,8 @@ layout(std140, binding = 0) uniform buf {
     vec3 iResolution;
     float iChannelTime[4];
     vec3 iChannelResolution[4];
+    vec4 iAudioBands; // sub bass, bass, mid, treble levels 0-1
+    vec4 iAudioBeat; // spectral flux, beat phase 0-1, bpm, loudness 0-1
 } ubuf;
 
 layout(binding = 1) uniform sampler2D iChannel0;